@@ -24,7 +24,11 @@
 #ifndef __TLC5955_HPP__
 #define __TLC5955_HPP__
 
+#include <span>
 #include <tlc5955_device.hpp>
+#include <tlc5955_frame.hpp>
+#include <tlc5955_gsclk.hpp>
+#include <tlc5955_stats.hpp>
 
 namespace tlc5955
 {
@@ -116,6 +120,27 @@ public:
     latch_after_send
   };
 
+  // @brief What send_frame() does with all-zero GS data frames
+  enum class BlankFrameOption
+  {
+    // @brief Every frame is sent
+    always_send,
+    // @brief Once an all-zero GS frame has been latched, further all-zero GS frames are not sent
+    skip_repeated,
+    // @brief As skip_repeated, and the GSCLK timer is also stopped while the outputs are blank
+    skip_repeated_stop_gsclk
+  };
+
+  // @brief How the blocking send path writes to the SPI data register
+  enum class SpiFrameMode
+  {
+    // @brief One byte per write
+    byte_frames,
+    // @brief Two bytes per 16-bit write, packed into the TX FIFO as 8-bit frames. Halves the TXE polls and
+    // writes. Used for transmit only; frames captured with sout are always sent as bytes.
+    packed_half_words
+  };
+
   // @brief Auto display repeat mode enable bit
   enum class DisplayFunction
   {
@@ -172,6 +197,23 @@ public:
     threshold_90_percent
   };
 
+  // @brief The control data for every chip in the chain. See init() for the defaults.
+  struct ControlData
+  {
+    DisplayFunction display{DisplayFunction::display_repeat_off};
+    TimingFunction timing{TimingFunction::timing_reset_on};
+    RefreshFunction refresh{RefreshFunction::auto_refresh_off};
+    PwmFunction pwm{PwmFunction::normal_pwm};
+    ShortDetectFunction short_detect{ShortDetectFunction::threshold_90_percent};
+    // @brief blue, green, red
+    std::array<uint8_t, 3> global_brightness{{0x1, 0x1, 0x1}};
+    // @brief blue, green, red
+    std::array<uint8_t, 3> max_current{{0x1, 0x1, 0x1}};
+    uint8_t dot_correction{0x1F};
+
+    bool operator==(const ControlData &) const = default;
+  };
+
   /// @brief Send configuration data to TLC5955.
   /// @param display Set the auto display repeat function
   /// @param timing Set the display timing reset mode
@@ -190,6 +232,33 @@ public:
             std::array<uint8_t, 3> max_current       = {{0x1, 0x1, 0x1}},
             uint8_t global_dot_correction            = 0x1F);
 
+  // @brief Send control data to every chip in the chain, unless it matches the control data already latched by
+  // update_control(). init() latches once, so the first update_control() after it always sends. The chain is shifted and latched twice, as the TLC5955 control latch needs two
+  // writes. Skipping unchanged writes also avoids the output blanking a control latch causes with timing_reset_on.
+  // The control image is packed with pack_control(), so GS data staged in the common register is kept.
+  // @param control The new control data
+  // @param num_chips The number of daisy-chained chips
+  // @return true if the control data was sent, false if it was unchanged (or num_chips is 0)
+  bool update_control(const ControlData &control, uint16_t num_chips);
+
+  // @brief Pack control data into one chip's frame, with the same layout as the common register but without touching
+  // it, e.g. to send with another transport
+  // @param control The control data
+  // @param chip The 96 byte chip frame to write
+  static void pack_control(const ControlData &control, std::span<uint8_t, chip_frame_size_bytes> chip);
+
+  // @brief Get the control data last sent by init() or update_control(). has_control() tells if it is fully latched.
+  const ControlData &get_control() const { return m_control; }
+
+  // @brief Check if the control data latched in the chips is known
+  bool has_control() const { return m_control_valid; }
+
+  // @brief Forget the latched control data so the next update_control() always sends, e.g. after a chip power cycle
+  void invalidate_control() { m_control_valid = false; }
+
+  // @brief Count a control write skipped because the chips already hold the data, e.g. by ChainControl::update()
+  void count_control_skip() { m_stats.add_control_skip(); }
+
   // @brief Clears the common register
   void clear_register();
 
@@ -212,6 +281,17 @@ public:
   // @param lsdvlt LED short detection voltage selection bit.
   void set_function_cmd(DisplayFunction dsprpt, TimingFunction tmgrst, RefreshFunction rfresh, PwmFunction espwm, ShortDetectFunction lsdvlt);
 
+  // @brief Get the 5 function control bits as set by set_function_cmd(), most significant bit first
+  static constexpr uint8_t function_cmd_bits(DisplayFunction dsprpt, TimingFunction tmgrst, RefreshFunction rfresh, PwmFunction espwm,
+                                             ShortDetectFunction lsdvlt)
+  {
+    return static_cast<uint8_t>(((dsprpt == DisplayFunction::display_repeat_on) ? 0x10U : 0U) |
+                                ((tmgrst == TimingFunction::timing_reset_on) ? 0x08U : 0U) |
+                                ((rfresh == RefreshFunction::auto_refresh_on) ? 0x04U : 0U) |
+                                ((espwm == PwmFunction::enhanced_pwm) ? 0x02U : 0U) |
+                                ((lsdvlt == ShortDetectFunction::threshold_90_percent) ? 0x01U : 0U));
+  }
+
   // @brief Set the global brightness cmd object
   // @param blue
   // @param green
@@ -257,6 +337,98 @@ public:
   // @param latch_option latch after send or no latch after send
   bool send_spi_bytes(LatchPinOption latch_option);
 
+  // @brief Shift packed chip data into the chain, with the first bit before each chip, and options with/without latch.
+  // The common register is not used. See GreyscaleFrame for the GS data layout.
+  // @param frame The chip data. Must be a multiple of 96 bytes.
+  // @param latch_type control message or data message
+  // @param latch_option latch after send or no latch after send
+  // @param sout Optional: receives the bytes shifted out of the chain while the frame is sent, e.g. the status
+  // information data for FaultBitmap::decode(). Must be the same size as frame. Needs the MISO pin
+  // (DriverSerialInterface::set_miso()). A frame with sout is never skipped as blank.
+  // @return false if the frame size is not a multiple of 96 bytes, or sout is the wrong size
+  bool send_frame(std::span<const uint8_t> frame, DataLatchType latch_type, LatchPinOption latch_option,
+                  std::span<uint8_t> sout = {});
+
+  // @brief Use externally owned memory as the frame store sent by send_frame_store(), e.g. a buffer in DMA capable
+  // SRAM or one the renderer writes. Nothing is copied, so write the store in place.
+  // @tparam EXTENT The store size. Must be a non-zero multiple of 96 bytes.
+  // @param store The store. Must stay valid until clear_frame_store().
+  // @return false if store is not aligned to frame_store_alignment
+  template <size_t EXTENT> bool set_frame_store(std::span<uint8_t, EXTENT> store)
+  {
+    static_assert(EXTENT != std::dynamic_extent, "The frame store size must be known at compile time");
+    static_assert(EXTENT > 0 && (EXTENT % chip_frame_size_bytes) == 0, "The frame store must be a multiple of 96 bytes");
+    if ((reinterpret_cast<uintptr_t>(store.data()) % frame_store_alignment) != 0)
+    {
+      return false;
+    }
+    m_frame_store = store;
+    return true;
+  }
+
+  // @brief Use a GreyscaleFrame as the frame store sent by send_frame_store(). Its alignment is checked at compile time.
+  // @param frame The frame. Must stay valid until clear_frame_store().
+  template <size_t NUM_CHIPS> void set_frame_store(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    static_assert(alignof(GreyscaleFrame<NUM_CHIPS>) >= frame_store_alignment, "The frame store is not aligned");
+    m_frame_store = frame.data();
+  }
+
+  // @brief Stop using the frame store
+  void clear_frame_store() { m_frame_store = {}; }
+
+  // @brief Get the frame store, empty if none is set
+  std::span<uint8_t> get_frame_store() const { return m_frame_store; }
+
+  // @brief Send the frame store. See send_frame().
+  // @return false if no frame store is set, or sout is the wrong size
+  bool send_frame_store(DataLatchType latch_type, LatchPinOption latch_option, std::span<uint8_t> sout = {})
+  {
+    return send_frame(m_frame_store, latch_type, latch_option, sout);
+  }
+
+  // @brief Pulse the LAT pin to copy the common shift register into the GS/control latches
+  void latch();
+
+  // @brief Choose whether send_frame() skips repeated all-zero GS frames. Sending non-zero GS data
+  // restarts the GSCLK timer (if stopped) before the frame is shifted, so the panel resumes with no extra frame.
+  // @param option See BlankFrameOption
+  void set_blank_frame_option(BlankFrameOption option) { m_blank_frame_option = option; }
+
+  // @brief Check if the last GS data latched by send_frame() was all zero
+  bool is_blanked() const { return m_blanked; }
+
+  // @brief Check if frame data is all zero
+  // @param frame The bytes to check
+  static bool is_blank_frame(std::span<const uint8_t> frame);
+
+  // @brief Program the GSCLK timer prescaler, auto-reload and compare registers for a display refresh rate.
+  // The timer and output channel are enabled by send_first_bit(), so call this before init().
+  // @param timer_clock_hz The GSCLK timer input clock frequency
+  // @param target_refresh_hz The required display refresh rate
+  // @param pwm The PWM mode selected by set_function_cmd(). ES-PWM updates the outputs every 512 GSCLKs.
+  // @return GsclkTiming The register values written and the achieved GSCLK/refresh rates
+  GsclkTiming configure_gsclk(uint32_t timer_clock_hz, uint32_t target_refresh_hz, PwmFunction pwm = PwmFunction::normal_pwm);
+
+  // @brief Pack two consecutive frame bytes into one SpiFrameMode::packed_half_words write. With 8-bit data frames the
+  // TX FIFO sends the low byte of a 16-bit write first, so first goes in the low byte and the wire order is unchanged.
+  // @param first The byte to send first
+  // @param second The byte to send second
+  static constexpr uint16_t spi_half_word(uint8_t first, uint8_t second) { return static_cast<uint16_t>(first | (second << 8)); }
+
+  // @brief Choose how the blocking send path writes the SPI data register
+  // @param mode See SpiFrameMode
+  void set_spi_frame_mode(SpiFrameMode mode) { m_spi_frame_mode = mode; }
+
+  // @brief Get the SPI frame mode
+  SpiFrameMode get_spi_frame_mode() const { return m_spi_frame_mode; }
+
+  // @brief Get a snapshot of the instrumentation counters. All zero unless built with TLC5955_ENABLE_STATS.
+  DriverStats get_stats() const { return m_stats.snapshot(); }
+
+  // @brief Reset the instrumentation counters
+  void reset_stats() { m_stats.reset(); }
+
 protected:
   // @brief The number of bytes in the buffer
   static const uint8_t m_common_reg_size_bytes{96};
@@ -269,6 +441,15 @@ protected:
   std::bitset<m_common_reg_size_bits> m_common_bit_register{0};
 
 private:
+  // drives several Driver SPI peripherals at the same time
+  template <size_t NUM_BUSES, size_t CHIPS_PER_BUS> friend class MultiBusDriver;
+  // feeds the SPI TX FIFO from a DMA channel
+  friend class SpiTxDma;
+  // sends the chain with DMA while packing the next chip
+  friend class PipelinedSender;
+  // checks the chains it schedules share one SPI bus
+  template <size_t MAX_CHAINS> friend class BusScheduler;
+
   // object containing SPI port/pins and pointer to CMSIS defined SPI peripheral
   DriverSerialInterface m_serial_interface;
 
@@ -323,15 +504,72 @@ private:
   // @brief greyscale data latch offset
   static constexpr uint8_t m_gs_data_offset{static_cast<uint8_t>(m_ctrl_cmd_offset)};
 
+  static_assert(FrameLayout::func_cmd_offset == m_func_cmd_offset && FrameLayout::bc_data_offset == m_bc_data_offset &&
+                    FrameLayout::mc_data_offset == m_mc_data_offset && FrameLayout::dc_data_offset == m_dc_data_offset &&
+                    FrameLayout::gs_data_offset == m_gs_data_offset,
+                "FrameLayout must match the common register layout");
+
   // @brief Don't Care bits. We set last bit to 1 for diagnostics purposes
   std::bitset<m_padding_size> m_padding{0x01};
 
   // @brief The control command. Always 0x96 (0b10010110)
   std::bitset<m_ctrl_cmd_size> m_ctrl_cmd{0x96};
 
+  // @brief Instrumentation counters. Empty when TLC5955_ENABLE_STATS is not defined.
+  [[no_unique_address]] stats::Counters<stats_enabled> m_stats;
+
+  // @brief What send_frame() does with all-zero GS data frames
+  BlankFrameOption m_blank_frame_option{BlankFrameOption::always_send};
+  // @brief true when the last GS data latched by send_frame() was all zero
+  bool m_blanked{false};
+
+  // @brief The externally owned frame store, empty if none is set
+  std::span<uint8_t> m_frame_store{};
+
+  // @brief How the blocking send path writes the SPI data register
+  SpiFrameMode m_spi_frame_mode{SpiFrameMode::byte_frames};
+
+  // @brief The control data last sent by init() or update_control()
+  ControlData m_control{};
+  // @brief true when m_control is known to be latched in every chip
+  bool m_control_valid{false};
+
+  // @brief Write the control command, padding and control data into the common register
+  // @param control The control data
+  void set_control_register(const ControlData &control);
+
+  // @brief true once a BusScheduler has configured the shared SPI bus for this chain, so shift_first_bit() only
+  // switches the MOSI/SCK pin modes instead of running gpio_init()/spi2_init()
+  bool m_shared_bus_configured{false};
+
+  // @brief Stop or restart the GSCLK timer counter
+  void enable_gsclk(bool enable);
+
+  // @brief Clock the first bit out with MOSI/SCK as GPIO, then return the pins to the SPI peripheral
+  // @param latch_type control message or data message
+  void shift_first_bit(DataLatchType latch_type);
+
+  // @brief Send bytes over SPI, blocking until they have been shifted out
+  // @param bytes The bytes to send
+  // @param sout Empty, or receives the same number of bytes from MISO (full-duplex only)
+  void send_bytes(std::span<const uint8_t> bytes, std::span<uint8_t> sout = {});
+
+  // @brief Block until the SPI TX FIFO is empty and the last byte has been shifted out
+  void spi_wait_idle();
+
   // @brief init the PB7/PB8 pins as SPI peripheral.
   void spi2_init(void);
 
+  // @brief Configure MOSI/SCK as SPI pins and enable the SPI peripheral, as after a first bit
+  void spi_bus_init(void);
+
+  // @brief Enable the GSCLK output channel and start the timer
+  void gsclk_output_init(void);
+
+  // @brief Hand MOSI/SCK to the SPI peripheral or take them back as GPIO outputs, changing only the pin modes
+  // @param spi true for the SPI alternate function, false for GPIO output
+  void set_spi_pin_mode(bool spi);
+
   // @brief init the PB7/PB8 pins as GPIO outputs.
   void gpio_init(void);
 };
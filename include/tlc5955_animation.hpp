@@ -0,0 +1,324 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_ANIMATION_HPP__
+#define __TLC5955_ANIMATION_HPP__
+
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief The curve from one keyframe to the next
+enum class Easing : uint8_t
+{
+  // @brief hold the colour until the next keyframe
+  step,
+  linear,
+  // @brief quadratic, slow start
+  ease_in,
+  // @brief quadratic, slow end
+  ease_out,
+  // @brief smoothstep, slow start and end
+  ease_in_out
+};
+
+// @brief A colour at a time. The easing applies from this keyframe to the next one.
+struct Keyframe
+{
+  uint32_t time_ms{0};
+  uint16_t red{0};
+  uint16_t green{0};
+  uint16_t blue{0};
+  Easing easing{Easing::linear};
+};
+
+// @brief Evaluate an easing curve
+// @param easing The curve
+// @param progress Q16: 0 to 65536
+// @return uint32_t The eased progress, Q16: 0 to 65536
+constexpr uint32_t ease(Easing easing, uint32_t progress)
+{
+  const uint64_t p    = (progress > 65536) ? 65536 : progress;
+  const uint64_t p_sq = (p * p) >> 16;
+  switch (easing)
+  {
+    case Easing::step:
+      return (p < 65536) ? 0 : 65536;
+    case Easing::ease_in:
+      return static_cast<uint32_t>(p_sq);
+    case Easing::ease_out:
+      return static_cast<uint32_t>(65536 - (((65536 - p) * (65536 - p)) >> 16));
+    case Easing::ease_in_out:
+      // 3p^2 - 2p^3
+      return static_cast<uint32_t>(3 * p_sq - ((2 * p_sq * p) >> 16));
+    case Easing::linear:
+    default:
+      return static_cast<uint32_t>(p);
+  }
+}
+
+// @brief Plays keyframe tracks into a GreyscaleFrame, one call to tick() per frame.
+// A track drives a group of consecutive LEDs (one LED for per-LED animation) from a sorted list of keyframes,
+// e.g. a constexpr table in flash or nodes from a StaticPool.
+//
+// Each segment between keyframes is split into m_pieces_per_segment linear pieces that follow the easing curve.
+// At the start of a piece the exact colour and a Q16 per-tick delta are cached, so every other tick costs one add
+// per channel. Tracks are evaluated once per tick whatever the number of LEDs they drive.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+// @tparam MAX_TRACKS The number of tracks
+template <size_t NUM_CHIPS, size_t MAX_TRACKS> class AnimationEngine
+{
+public:
+  // @brief The number of linear pieces used for each eased segment
+  static constexpr uint32_t m_pieces_per_segment{8};
+
+  // @brief Construct a new Animation Engine object
+  // @param frame The GS storage to write, e.g. the frame passed to Driver::send_frame()
+  // @param tick_hz The number of tick() calls per second, normally the frame rate
+  AnimationEngine(GreyscaleFrame<NUM_CHIPS> &frame, uint32_t tick_hz)
+      : m_frame(frame),
+        m_tick_hz(tick_hz)
+  {
+  }
+
+  // @brief Add a track
+  // @param first_led The first LED in the chain driven by this track
+  // @param num_leds The number of consecutive LEDs driven by this track
+  // @param keyframes At least one keyframe, sorted by time. Must outlive the engine.
+  // @param loop true to restart from the first keyframe after the last one
+  // @return false if there are already MAX_TRACKS tracks, or the LEDs or keyframes are invalid
+  bool add_track(size_t first_led, size_t num_leds, std::span<const Keyframe> keyframes, bool loop = false)
+  {
+    if (!(m_num_tracks < MAX_TRACKS) || keyframes.empty() || num_leds == 0 ||
+        first_led + num_leds > GreyscaleFrame<NUM_CHIPS>::m_num_leds)
+    {
+      return false;
+    }
+    for (size_t idx = 1; idx < keyframes.size(); idx++)
+    {
+      if (keyframes[idx].time_ms < keyframes[idx - 1].time_ms)
+      {
+        return false;
+      }
+    }
+    m_tracks[m_num_tracks++] = Track{keyframes, first_led, num_leds, loop, TrackState{}};
+    return true;
+  }
+
+  // @brief Remove all tracks
+  void clear_tracks() { m_num_tracks = 0; }
+
+  // @brief Restart every track from its first keyframe
+  void restart()
+  {
+    for (size_t idx = 0; idx < m_num_tracks; idx++)
+    {
+      m_tracks[idx].state = TrackState{};
+    }
+  }
+
+  // @brief Write the current colour of every track into the frame and advance one tick
+  void tick()
+  {
+    for (size_t idx = 0; idx < m_num_tracks; idx++)
+    {
+      tick_track(m_tracks[idx]);
+    }
+  }
+
+  // @brief Render ahead of time, e.g. a whole show on the host: one tick per output frame
+  // @param frames Each frame is written with the frame contents after one tick
+  void render(std::span<GreyscaleFrame<NUM_CHIPS>> frames)
+  {
+    for (GreyscaleFrame<NUM_CHIPS> &frame : frames)
+    {
+      tick();
+      frame = m_frame;
+    }
+  }
+
+  // @brief Check if every non-looping track has reached its last keyframe
+  bool is_finished() const
+  {
+    for (size_t idx = 0; idx < m_num_tracks; idx++)
+    {
+      if (!m_tracks[idx].state.finished)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  // @brief The playback state of one track
+  struct TrackState
+  {
+    bool finished{false};
+    // @brief the keyframe at the start of the current segment
+    size_t segment{0};
+    // @brief ticks since the track started (or looped)
+    uint32_t tick{0};
+    // @brief the tick at which the value and delta are recomputed
+    uint32_t piece_end{0};
+    // @brief Q16 colour in GS channel order
+    std::array<uint32_t, colour_channels_per_led> value{};
+    // @brief Q16 per-tick change in GS channel order, two's complement so that adding wraps to the right value
+    std::array<uint32_t, colour_channels_per_led> delta{};
+  };
+
+  // @brief One track
+  struct Track
+  {
+    std::span<const Keyframe> keyframes{};
+    size_t first_led{0};
+    size_t num_leds{0};
+    bool loop{false};
+    TrackState state{};
+  };
+
+  // @brief The GS storage
+  GreyscaleFrame<NUM_CHIPS> &m_frame;
+  // @brief The number of tick() calls per second
+  uint32_t m_tick_hz;
+  // @brief The tracks
+  std::array<Track, MAX_TRACKS> m_tracks{};
+  // @brief The number of tracks in use
+  size_t m_num_tracks{0};
+
+  // @brief Convert a keyframe time to ticks
+  uint32_t to_ticks(uint32_t time_ms) const { return static_cast<uint32_t>((static_cast<uint64_t>(time_ms) * m_tick_hz) / 1000); }
+
+  // @brief Get a keyframe colour in GS channel order
+  static std::array<int32_t, colour_channels_per_led> colour_of(const Keyframe &keyframe)
+  {
+    std::array<int32_t, colour_channels_per_led> colour{};
+    colour[static_cast<size_t>(ColourChannel::blue)]  = keyframe.blue;
+    colour[static_cast<size_t>(ColourChannel::green)] = keyframe.green;
+    colour[static_cast<size_t>(ColourChannel::red)]   = keyframe.red;
+    return colour;
+  }
+
+  // @brief Get the Q16 colour of a segment at a tick
+  static int64_t value_at(int32_t from, int32_t to, Easing easing, uint32_t elapsed, uint32_t duration)
+  {
+    const uint32_t progress = static_cast<uint32_t>((static_cast<uint64_t>(elapsed) << 16) / duration);
+    return (static_cast<int64_t>(from) << 16) + static_cast<int64_t>(to - from) * ease(easing, progress);
+  }
+
+  // @brief Find the segment for the track's tick, then cache its exact value and the delta to the next piece
+  void start_piece(Track &track)
+  {
+    const std::span<const Keyframe> keyframes = track.keyframes;
+    TrackState &state                         = track.state;
+    const uint32_t first_tick                 = to_ticks(keyframes.front().time_ms);
+    const uint32_t last_tick                  = to_ticks(keyframes.back().time_ms);
+    if (state.tick >= last_tick && track.loop && last_tick > first_tick)
+    {
+      state.tick    = first_tick;
+      state.segment = 0;
+    }
+
+    while (state.segment + 1 < keyframes.size() && state.tick >= to_ticks(keyframes[state.segment + 1].time_ms))
+    {
+      state.segment++;
+    }
+
+    const std::array<int32_t, colour_channels_per_led> from = colour_of(keyframes[state.segment]);
+    const uint32_t start_tick                               = to_ticks(keyframes[state.segment].time_ms);
+    if (state.segment + 1 >= keyframes.size() || state.tick < start_tick)
+    {
+      // before the first keyframe, or holding the last one
+      for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+      {
+        state.value[colour_idx] = static_cast<uint32_t>(from[colour_idx]) << 16;
+        state.delta[colour_idx] = 0;
+      }
+      state.finished  = (state.tick >= start_tick) && !track.loop;
+      state.piece_end = (state.tick < start_tick) ? start_tick : UINT32_MAX;
+      return;
+    }
+
+    const std::array<int32_t, colour_channels_per_led> to = colour_of(keyframes[state.segment + 1]);
+    const Easing easing                                   = keyframes[state.segment].easing;
+    const uint32_t duration                               = to_ticks(keyframes[state.segment + 1].time_ms) - start_tick;
+    const uint32_t elapsed                                = state.tick - start_tick;
+
+    // the next piece boundary after this tick; a step holds for the whole segment
+    uint32_t piece_end = duration;
+    if (easing != Easing::step)
+    {
+      for (uint32_t piece = 1; piece < m_pieces_per_segment; piece++)
+      {
+        const uint32_t boundary = (duration * piece) / m_pieces_per_segment;
+        if (boundary > elapsed)
+        {
+          piece_end = boundary;
+          break;
+        }
+      }
+    }
+
+    for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+    {
+      const int64_t value     = value_at(from[colour_idx], to[colour_idx], easing, elapsed, duration);
+      const int64_t end_value = (easing == Easing::step) ? value : value_at(from[colour_idx], to[colour_idx], easing, piece_end, duration);
+      state.value[colour_idx] = static_cast<uint32_t>(value);
+      state.delta[colour_idx] = static_cast<uint32_t>((end_value - value) / static_cast<int64_t>(piece_end - elapsed));
+    }
+    state.piece_end = start_tick + piece_end;
+  }
+
+  // @brief Write one track and advance it one tick
+  void tick_track(Track &track)
+  {
+    TrackState &state = track.state;
+    if (state.finished)
+    {
+      return;
+    }
+    if (state.tick >= state.piece_end)
+    {
+      start_piece(track);
+    }
+
+    const uint16_t red   = static_cast<uint16_t>(state.value[static_cast<size_t>(ColourChannel::red)] >> 16);
+    const uint16_t green = static_cast<uint16_t>(state.value[static_cast<size_t>(ColourChannel::green)] >> 16);
+    const uint16_t blue  = static_cast<uint16_t>(state.value[static_cast<size_t>(ColourChannel::blue)] >> 16);
+    for (size_t led_idx = track.first_led; led_idx < track.first_led + track.num_leds; led_idx++)
+    {
+      m_frame.set_rgb(led_idx, red, green, blue);
+    }
+
+    for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+    {
+      state.value[colour_idx] += state.delta[colour_idx];
+    }
+    state.tick++;
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_ANIMATION_HPP__
@@ -0,0 +1,254 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_BUS_SCHEDULER_HPP__
+#define __TLC5955_BUS_SCHEDULER_HPP__
+
+#include <tlc5955.hpp>
+
+namespace tlc5955
+{
+
+// @brief BusScheduler counters
+struct BusSchedulerStats
+{
+  // @brief number of frames sent
+  uint32_t frames_sent{0};
+  // @brief number of frames taken from the queue but rejected by Driver::send_frame()
+  uint32_t frames_failed{0};
+  // @brief number of pending frames replaced by a newer frame for the same chain before they were sent
+  uint32_t frames_superseded{0};
+};
+
+// @brief Shares one SPI peripheral between several daisy chains, each with its own Driver and LAT line.
+//
+// Each chain has one pending frame slot: submit() queues a frame, replacing one that has not been sent yet,
+// so a chain never falls behind its newest data. run_next() sends the pending frame of the highest priority
+// chain (the oldest submission first on a tie) back-to-back with the rest, and pulses only that chain's LAT.
+// All the chains must use the same SPI peripheral, MOSI/SCK pins and MISO setup. The scheduler configures the bus
+// once, before its first frame, and from then on each chip only switches MOSI/SCK between GPIO and SPI for its
+// first bit. Once chains are added, send to them only through the scheduler. Frames are not copied.
+// @tparam MAX_CHAINS The maximum number of chains on the bus
+template <size_t MAX_CHAINS> class BusScheduler : public RestrictedBase
+{
+public:
+  static_assert(MAX_CHAINS > 0, "BusScheduler needs at least one chain");
+
+  BusScheduler() = default;
+
+  // @brief Give the drivers back their full bus setup for each first bit
+  ~BusScheduler()
+  {
+    for (size_t chain_idx = 0; chain_idx < m_num_chains; chain_idx++)
+    {
+      m_chains[chain_idx].driver->m_shared_bus_configured = false;
+    }
+  }
+
+  // @brief Add a chain. Chains are usually added once at startup, after each Driver is init()'d.
+  // @param driver The driver for the chain
+  // @param priority Higher is sent first, e.g. for the fastest changing chain
+  // @return int The chain index, or -1 if MAX_CHAINS is reached or the driver uses a different SPI bus setup
+  int add_chain(Driver &driver, uint8_t priority)
+  {
+    if (m_num_chains == MAX_CHAINS)
+    {
+      return -1;
+    }
+    if (m_num_chains > 0)
+    {
+      DriverSerialInterface &first = m_chains[0].driver->m_serial_interface;
+      DriverSerialInterface &added = driver.m_serial_interface;
+      if (&first.get_spi_handle() != &added.get_spi_handle() || &first.get_mosi_port() != &added.get_mosi_port() ||
+          first.get_mosi_pin() != added.get_mosi_pin() || &first.get_sck_port() != &added.get_sck_port() ||
+          first.get_sck_pin() != added.get_sck_pin() || first.get_miso_port() != added.get_miso_port() ||
+          first.get_miso_pin() != added.get_miso_pin() || first.get_miso_af() != added.get_miso_af())
+      {
+        return -1;
+      }
+    }
+    if (m_bus_configured)
+    {
+      driver.gsclk_output_init();
+      driver.m_shared_bus_configured = true;
+    }
+    m_chains[m_num_chains] = Chain{};
+    m_chains[m_num_chains].driver   = &driver;
+    m_chains[m_num_chains].priority = priority;
+    return static_cast<int>(m_num_chains++);
+  }
+
+  // @brief Change a chain's priority
+  // @param chain_idx The chain from add_chain()
+  // @param priority Higher is sent first
+  // @return false if chain_idx is out of range
+  bool set_priority(size_t chain_idx, uint8_t priority)
+  {
+    if (!(chain_idx < m_num_chains))
+    {
+      return false;
+    }
+    m_chains[chain_idx].priority = priority;
+    return true;
+  }
+
+  // @brief Queue a frame for a chain, replacing its pending frame if it has not been sent yet
+  // @param chain_idx The chain from add_chain()
+  // @param frame The chip data, see Driver::send_frame(). Must stay unchanged until it is sent.
+  // @param latch_type control message or data message
+  // @param latch_option latch after send or no latch after send
+  // @return false if chain_idx is out of range or the frame size is not a multiple of 96 bytes
+  bool submit(size_t chain_idx, std::span<const uint8_t> frame, Driver::DataLatchType latch_type = Driver::DataLatchType::data,
+              Driver::LatchPinOption latch_option = Driver::LatchPinOption::latch_after_send)
+  {
+    if (!(chain_idx < m_num_chains) || frame.empty() || (frame.size() % chip_frame_size_bytes) != 0)
+    {
+      return false;
+    }
+    Chain &chain = m_chains[chain_idx];
+    if (chain.pending)
+    {
+      m_stats.frames_superseded++;
+    }
+    else
+    {
+      // a replaced frame keeps its place in the queue
+      chain.sequence = m_next_sequence++;
+    }
+    chain.frame        = frame;
+    chain.latch_type   = latch_type;
+    chain.latch_option = latch_option;
+    chain.pending      = true;
+    return true;
+  }
+
+  // @brief Check if a chain has a frame waiting to be sent
+  bool is_pending(size_t chain_idx) const { return chain_idx < m_num_chains && m_chains[chain_idx].pending; }
+
+  // @brief Send the next pending frame: highest priority first, then the oldest submission
+  // @return int The chain that was sent, or -1 if nothing was pending. A frame Driver::send_frame() rejects is
+  // dropped and counted in BusSchedulerStats::frames_failed instead of frames_sent, and its chain is still returned.
+  int run_next()
+  {
+    int next_idx = -1;
+    for (size_t chain_idx = 0; chain_idx < m_num_chains; chain_idx++)
+    {
+      const Chain &chain = m_chains[chain_idx];
+      if (!chain.pending)
+      {
+        continue;
+      }
+      if (next_idx < 0)
+      {
+        next_idx = static_cast<int>(chain_idx);
+        continue;
+      }
+      const Chain &best = m_chains[static_cast<size_t>(next_idx)];
+      // wrap-safe sequence compare
+      if (chain.priority > best.priority ||
+          (chain.priority == best.priority && static_cast<int32_t>(chain.sequence - best.sequence) < 0))
+      {
+        next_idx = static_cast<int>(chain_idx);
+      }
+    }
+    if (next_idx < 0)
+    {
+      return -1;
+    }
+
+    if (!m_bus_configured)
+    {
+      configure_bus();
+    }
+
+    Chain &chain  = m_chains[static_cast<size_t>(next_idx)];
+    chain.pending = false;
+    if (chain.driver->send_frame(chain.frame, chain.latch_type, chain.latch_option))
+    {
+      m_stats.frames_sent++;
+    }
+    else
+    {
+      m_stats.frames_failed++;
+    }
+    return next_idx;
+  }
+
+  // @brief Send every pending frame in priority order
+  // @return size_t The number of frames sent, not counting frames Driver::send_frame() rejected
+  size_t run()
+  {
+    const uint32_t frames_sent = m_stats.frames_sent;
+    while (run_next() >= 0)
+    {
+      // each call sends or drops one pending frame
+    }
+    return m_stats.frames_sent - frames_sent;
+  }
+
+  // @brief Get the number of chains
+  size_t get_num_chains() const { return m_num_chains; }
+
+  // @brief Get the counters
+  BusSchedulerStats get_stats() const { return m_stats; }
+
+  // @brief Check if the shared bus has been configured, i.e. a frame has been sent
+  bool is_bus_configured() const { return m_bus_configured; }
+
+private:
+  // @brief Set up the SPI peripheral and pins once for every chain, and start each chain's GSCLK output
+  void configure_bus()
+  {
+    m_chains[0].driver->spi_bus_init();
+    for (size_t chain_idx = 0; chain_idx < m_num_chains; chain_idx++)
+    {
+      m_chains[chain_idx].driver->gsclk_output_init();
+      m_chains[chain_idx].driver->m_shared_bus_configured = true;
+    }
+    m_bus_configured = true;
+  }
+
+  // @brief One chain and its pending frame slot
+  struct Chain
+  {
+    Driver *driver{nullptr};
+    uint8_t priority{0};
+    bool pending{false};
+    // @brief The submission order of the pending frame
+    uint32_t sequence{0};
+    std::span<const uint8_t> frame{};
+    Driver::DataLatchType latch_type{Driver::DataLatchType::data};
+    Driver::LatchPinOption latch_option{Driver::LatchPinOption::latch_after_send};
+  };
+
+  std::array<Chain, MAX_CHAINS> m_chains{};
+  size_t m_num_chains{0};
+  uint32_t m_next_sequence{0};
+  // @brief true once configure_bus() has run
+  bool m_bus_configured{false};
+  BusSchedulerStats m_stats{};
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_BUS_SCHEDULER_HPP__
@@ -0,0 +1,219 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_CHAIN_CONTROL_HPP__
+#define __TLC5955_CHAIN_CONTROL_HPP__
+
+#include <tlc5955.hpp>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief The control data for one chip. Unlike Driver::ControlData, DC is set per output.
+struct ChipControl
+{
+  Driver::DisplayFunction display{Driver::DisplayFunction::display_repeat_off};
+  Driver::TimingFunction timing{Driver::TimingFunction::timing_reset_on};
+  Driver::RefreshFunction refresh{Driver::RefreshFunction::auto_refresh_off};
+  Driver::PwmFunction pwm{Driver::PwmFunction::normal_pwm};
+  Driver::ShortDetectFunction short_detect{Driver::ShortDetectFunction::threshold_90_percent};
+  // @brief BC 0-127: blue, green, red
+  std::array<uint8_t, 3> global_brightness{{0x1, 0x1, 0x1}};
+  // @brief MC 0-7: blue, green, red
+  std::array<uint8_t, 3> max_current{{0x1, 0x1, 0x1}};
+  // @brief DC 0-127 in GS channel order (see GreyscaleFrame)
+  std::array<uint8_t, gs_channels_per_chip> dot_correction{filled_dot_correction(0x1F)};
+
+  bool operator==(const ChipControl &) const = default;
+
+  // @brief Get a DC table with every output set to the same value
+  static constexpr std::array<uint8_t, gs_channels_per_chip> filled_dot_correction(uint8_t dc)
+  {
+    std::array<uint8_t, gs_channels_per_chip> table{};
+    table.fill(dc);
+    return table;
+  }
+
+  // @brief Get the per-chip control data equivalent to Driver::ControlData
+  static constexpr ChipControl from(const Driver::ControlData &control)
+  {
+    return ChipControl{control.display,           control.timing,      control.refresh,
+                       control.pwm,               control.short_detect, control.global_brightness,
+                       control.max_current,       filled_dot_correction(control.dot_correction)};
+  }
+};
+
+// @brief Different control data (FC, BC, MC and DC) for each chip in a daisy chain, packed into one control
+// stream so the whole chain is written with a single shift and latch instead of a frame per chip.
+//
+// The control data last latched into each chip is kept, so update() only sends when a chip has changed.
+// As with Driver::update_control() the chain is written twice. Chip 0 is shifted first, as in GreyscaleFrame.
+// update() makes the Driver forget its own control data shadow; call invalidate() after writing control data
+// any other way, e.g. Driver::init().
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class ChainControl : public RestrictedBase
+{
+public:
+  static_assert(NUM_CHIPS > 0, "ChainControl needs at least one chip");
+
+  // @brief The number of bytes in the control stream
+  static constexpr size_t m_size_bytes{NUM_CHIPS * chip_frame_size_bytes};
+
+  ChainControl() = default;
+
+  // @brief Set all the control data for one chip
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param control The control data
+  // @return false if chip_idx is out of range
+  bool set_chip(size_t chip_idx, const ChipControl &control)
+  {
+    if (!(chip_idx < NUM_CHIPS))
+    {
+      return false;
+    }
+    m_chips[chip_idx] = control;
+    return true;
+  }
+
+  // @brief Set every chip to the same control data
+  void set_all(const ChipControl &control) { m_chips.fill(control); }
+
+  // @brief Get the control data for one chip
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  const ChipControl &get_chip(size_t chip_idx) const { return m_chips[chip_idx]; }
+
+  // @brief Set the BC of one chip
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @return false if chip_idx is out of range
+  bool set_global_brightness(size_t chip_idx, uint8_t blue, uint8_t green, uint8_t red)
+  {
+    if (!(chip_idx < NUM_CHIPS))
+    {
+      return false;
+    }
+    m_chips[chip_idx].global_brightness = {{blue, green, red}};
+    return true;
+  }
+
+  // @brief Set the DC of one output
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47
+  // @param dc Must be value: 0-127
+  // @return false if either index is out of range
+  bool set_dot_correction(size_t chip_idx, size_t channel_idx, uint8_t dc)
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return false;
+    }
+    m_chips[chip_idx].dot_correction[channel_idx] = dc;
+    return true;
+  }
+
+  // @brief Check if any chip's control data differs from what was last latched, or nothing has been latched
+  bool is_changed() const { return !m_latched_valid || m_chips != m_latched; }
+
+  // @brief Forget the latched control data so the next update() always sends
+  void invalidate() { m_latched_valid = false; }
+
+  // @brief Pack the control data for every chip into the control stream
+  void pack()
+  {
+    m_stream.fill(0);
+    for (size_t chip_idx = 0; chip_idx < NUM_CHIPS; chip_idx++)
+    {
+      pack_chip(m_chips[chip_idx], std::span<uint8_t, chip_frame_size_bytes>(m_stream.data() + chip_idx * chip_frame_size_bytes,
+                                                                            chip_frame_size_bytes));
+    }
+  }
+
+  // @brief Get the control stream last packed by pack() or update(), e.g. to send with another transport.
+  // Send it with a control first bit before each chip.
+  std::span<const uint8_t, m_size_bytes> data() const { return m_stream; }
+
+  // @brief Send the control stream if any chip has changed, writing the whole chain twice
+  // @param driver The driver for the chain
+  // @return true if the control data was sent, false if no chip had changed or the Driver rejected the stream.
+  // A rejected stream leaves the latched control data unknown, so the next update() sends again.
+  bool update(Driver &driver)
+  {
+    if (!is_changed())
+    {
+      driver.count_control_skip();
+      return false;
+    }
+    pack();
+    driver.invalidate_control();
+    for (uint8_t write_count = 0; write_count < 2; write_count++)
+    {
+      if (!driver.send_frame(m_stream, Driver::DataLatchType::control, Driver::LatchPinOption::latch_after_send))
+      {
+        m_latched_valid = false;
+        return false;
+      }
+    }
+    m_latched       = m_chips;
+    m_latched_valid = true;
+    return true;
+  }
+
+private:
+  // @brief The control data to send
+  std::array<ChipControl, NUM_CHIPS> m_chips{};
+  // @brief The control data last latched by update()
+  std::array<ChipControl, NUM_CHIPS> m_latched{};
+  // @brief true when m_latched matches the chips
+  bool m_latched_valid{false};
+  // @brief The packed control stream
+  alignas(4) std::array<uint8_t, m_size_bytes> m_stream{0};
+
+  // @brief Pack one chip with the same layout as the Driver common register
+  static void pack_chip(const ChipControl &control, std::span<uint8_t, chip_frame_size_bytes> chip)
+  {
+    write_frame_bits(chip, FrameLayout::ctrl_cmd_offset, FrameLayout::ctrl_cmd, FrameLayout::ctrl_cmd_size);
+    // last padding bit set, as Driver::m_padding
+    write_frame_bits(chip, FrameLayout::func_cmd_offset - 1, 0x1, 1);
+
+    const uint8_t function_cmd =
+        Driver::function_cmd_bits(control.display, control.timing, control.refresh, control.pwm, control.short_detect);
+    write_frame_bits(chip, FrameLayout::func_cmd_offset, function_cmd, FrameLayout::func_cmd_size);
+
+    for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+    {
+      write_frame_bits(chip, FrameLayout::bc_data_offset + FrameLayout::bc_data_size * colour_idx,
+                       control.global_brightness[colour_idx] & 0x7F, FrameLayout::bc_data_size);
+      write_frame_bits(chip, FrameLayout::mc_data_offset + FrameLayout::mc_data_size * colour_idx, control.max_current[colour_idx] & 0x7,
+                       FrameLayout::mc_data_size);
+    }
+    for (size_t channel_idx = 0; channel_idx < gs_channels_per_chip; channel_idx++)
+    {
+      write_frame_bits(chip, FrameLayout::dc_data_offset + FrameLayout::dc_data_size * channel_idx,
+                       control.dot_correction[channel_idx] & 0x7F, FrameLayout::dc_data_size);
+    }
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_CHAIN_CONTROL_HPP__
@@ -0,0 +1,125 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_CHAIN_RENDERER_HPP__
+#define __TLC5955_CHAIN_RENDERER_HPP__
+
+#if defined(__linux__)
+
+  #include <atomic>
+  #include <functional>
+  #include <memory>
+  #include <span>
+  #include <stdint.h>
+  #include <thread>
+  #include <vector>
+
+namespace tlc5955
+{
+
+// @brief Renders many independent chains per frame on a pool of worker threads (host only).
+//
+// Each worker owns a contiguous share of the chains and takes them from the front of its share;
+// a worker that runs out steals from the back of another worker's share. Both ends of a share live in
+// one atomic word, so taking and stealing are a single compare-and-swap and there are no locks.
+// Each worker has its own scratch buffer, e.g. for pack_chain_bitstream(), and the job should hand
+// its chain to the transport as soon as it is packed rather than waiting for the whole frame.
+// The thread calling render_frame() works as worker 0.
+class ChainSetRenderer
+{
+public:
+  // @brief Renders and sends one chain
+  // @param chain_idx The chain to render: 0 to num_chains-1
+  // @param scratch The calling worker's scratch buffer
+  using ChainJob = std::function<void(size_t chain_idx, std::span<uint8_t> scratch)>;
+
+  // @brief The maximum number of chains
+  static constexpr size_t max_chains{0xFFFFFF};
+
+  // @brief Construct a new Chain Set Renderer object and start the worker threads
+  // @param num_chains The number of chains rendered per frame. Must be value: 0 to max_chains, or render_frame() fails
+  // @param scratch_bytes The size of each worker's scratch buffer
+  // @param job Called once per chain per frame
+  // @param num_workers The number of workers including the calling thread. 0 uses one per core.
+  ChainSetRenderer(size_t num_chains, size_t scratch_bytes, ChainJob job, size_t num_workers = 0);
+
+  // @brief Stop and join the worker threads
+  ~ChainSetRenderer();
+
+  ChainSetRenderer(const ChainSetRenderer &)            = delete;
+  ChainSetRenderer &operator=(const ChainSetRenderer &) = delete;
+
+  // @brief Run the job for every chain and block until all are done
+  // @return false if num_chains is more than max_chains, and no chain is rendered
+  bool render_frame();
+
+  // @brief The number of workers including the calling thread
+  size_t get_num_workers() const { return m_num_workers; }
+
+  // @brief The number of chains taken from another worker's share since construction
+  uint64_t get_steal_count() const { return m_steal_count.load(std::memory_order_relaxed); }
+
+private:
+  // @brief One worker's share of the chains: front in bits 0-23, back (exclusive) in bits 24-47 and the
+  // epoch of the frame it belongs to in bits 48-63
+  struct alignas(64) WorkerShare
+  {
+    std::atomic<uint64_t> range{0};
+  };
+
+  // @brief The number of chains rendered per frame
+  size_t m_num_chains;
+  // @brief The number of workers including the calling thread
+  size_t m_num_workers;
+  // @brief Renders and sends one chain
+  ChainJob m_job;
+  // @brief Each worker's share of the chains
+  std::unique_ptr<WorkerShare[]> m_shares;
+  // @brief Each worker's scratch buffer
+  std::vector<std::vector<uint8_t>> m_scratch;
+  // @brief Worker threads 1 to m_num_workers-1
+  std::vector<std::thread> m_threads;
+  // @brief Incremented to start a frame
+  std::atomic<uint32_t> m_epoch{0};
+  // @brief Chains not yet finished in this frame
+  std::atomic<size_t> m_remaining{0};
+  // @brief Set to stop the worker threads
+  std::atomic<bool> m_stop{false};
+  // @brief The number of stolen chains
+  std::atomic<uint64_t> m_steal_count{0};
+
+  // @brief Worker thread main loop
+  void run_worker(size_t worker_idx);
+  // @brief Render chains of frame epoch until none are left in any share
+  void work(size_t worker_idx, uint32_t epoch);
+  // @brief Take the chain at the front of a share, if the share belongs to frame epoch
+  bool take_front(size_t worker_idx, uint32_t epoch, uint32_t &chain_idx);
+  // @brief Take the chain at the back of a share, if the share belongs to frame epoch
+  bool take_back(size_t worker_idx, uint32_t epoch, uint32_t &chain_idx);
+};
+
+} // namespace tlc5955
+
+#endif // __linux__
+
+#endif // __TLC5955_CHAIN_RENDERER_HPP__
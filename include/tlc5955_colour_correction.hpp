@@ -0,0 +1,125 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_COLOUR_CORRECTION_HPP__
+#define __TLC5955_COLOUR_CORRECTION_HPP__
+
+#include <tlc5955_frame.hpp>
+#include <tlc5955_gamma.hpp>
+
+namespace tlc5955
+{
+
+// @brief A 3x3 colour-correction matrix in signed Q12 (4096 = 1.0).
+// Row r gives output colour r from the linear (post-gamma) red, green and blue inputs:
+// {rr, rg, rb, gr, gg, gb, br, bg, bb}. 18 bytes, so tables can be constexpr and live in flash.
+struct ColourMatrix
+{
+  std::array<int16_t, 9> coefficients{};
+};
+
+// @brief 1.0 in the ColourMatrix fixed-point format
+inline constexpr int32_t colour_matrix_one{4096};
+// @brief The coefficient limit. Keeps every row sum within 32 bits for any 16-bit input.
+inline constexpr double colour_matrix_max_coefficient{2.0};
+
+// @brief Build a ColourMatrix at compile time. Coefficients are clamped to +/- colour_matrix_max_coefficient.
+// @param rows Row-major coefficients: red row, green row, blue row
+constexpr ColourMatrix make_colour_matrix(const std::array<double, 9> &rows)
+{
+  ColourMatrix matrix{};
+  for (size_t idx = 0; idx < rows.size(); idx++)
+  {
+    double coefficient = rows[idx];
+    if (coefficient > colour_matrix_max_coefficient)
+    {
+      coefficient = colour_matrix_max_coefficient;
+    }
+    if (coefficient < -colour_matrix_max_coefficient)
+    {
+      coefficient = -colour_matrix_max_coefficient;
+    }
+    const double scaled      = coefficient * colour_matrix_one;
+    matrix.coefficients[idx] = static_cast<int16_t>(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+  }
+  return matrix;
+}
+
+// @brief The matrix that leaves colours unchanged
+inline constexpr ColourMatrix identity_colour_matrix{make_colour_matrix({1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0})};
+
+// @brief Converts 8-bit RGB to packed GS data in one fused pass per LED: gamma, then the LED's colour-correction
+// matrix, then global brightness. No intermediate frame is written.
+//
+// The matrices can be given one per LED, or as a small table (e.g. one per LED bin) with a per-LED index,
+// which costs one byte per LED. Both spans normally point at constexpr tables in flash.
+class ColourCorrector
+{
+public:
+  // @brief Construct a new Colour Corrector object
+  // @param gamma The table for 8-bit levels
+  // @param matrices No matrices (gamma and brightness only), one per LED, or a table indexed by led_matrix_idx
+  // @param led_matrix_idx Empty, or the index into matrices for each LED. Out of range indices use the identity.
+  explicit ColourCorrector(const GammaTable &gamma = gamma_table_2_2, std::span<const ColourMatrix> matrices = {},
+                           std::span<const uint8_t> led_matrix_idx = {});
+
+  // @brief Set the global brightness applied after the matrix
+  // @param brightness Q8: 0 to 256, where 256 is full scale. Larger values are clamped.
+  void set_brightness(uint16_t brightness);
+
+  // @brief Get the global brightness
+  uint16_t get_brightness() const { return m_brightness; }
+
+  // @brief Gamma-correct, colour-correct and scale 8-bit RGB into packed GS data
+  // @param rgb 3 bytes per LED in the order red, green, blue
+  // @param gs_bytes The packed GS data for the same LEDs, e.g. GreyscaleFrame::data()
+  // @param first_led The chain index of the first LED in rgb, used to select its matrix
+  // @return false if gs_bytes is not 6 bytes per LED in rgb, or rgb is not a whole number of LEDs
+  bool pack(std::span<const uint8_t> rgb, std::span<uint8_t> gs_bytes, size_t first_led = 0) const;
+
+  // @brief Gamma-correct, colour-correct and scale 8-bit RGB into a whole frame
+  // @param rgb 3 bytes per LED in the order red, green, blue. Must cover every LED in the frame.
+  // @param frame The frame to write
+  // @return false if rgb is the wrong size
+  template <size_t NUM_CHIPS> bool pack(std::span<const uint8_t> rgb, GreyscaleFrame<NUM_CHIPS> &frame) const
+  {
+    return pack(rgb, frame.data());
+  }
+
+private:
+  // @brief The table for 8-bit levels
+  const GammaTable &m_gamma;
+  // @brief One matrix per LED, a table, or empty
+  std::span<const ColourMatrix> m_matrices;
+  // @brief Per-LED index into m_matrices, or empty
+  std::span<const uint8_t> m_led_matrix_idx;
+  // @brief Q8 global brightness
+  uint16_t m_brightness{256};
+
+  // @brief Get the matrix for an LED, or nullptr for none
+  const ColourMatrix *matrix_for(size_t led_idx) const;
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_COLOUR_CORRECTION_HPP__
@@ -0,0 +1,245 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_COMMAND_BUFFER_HPP__
+#define __TLC5955_COMMAND_BUFFER_HPP__
+
+#include <algorithm>
+#include <tlc5955.hpp>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief Records GS or control field edits for a daisy chain and applies them to packed chip data in one pass.
+//
+// Recording only stores the field offset and value. execute() sorts the edits by offset so the data is written
+// front to back, coalesces edits to the same field (the last one recorded wins) and packs them straight into
+// the bytes sent over SPI, e.g. GreyscaleFrame::data() or a ChainControl style control stream.
+// The sorted order is kept, so replaying a buffer (e.g. a repeating sequence) costs only the writes.
+// Don't mix GS and control edits in one buffer: they overlap and are sent with different latch types.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+// @tparam MAX_COMMANDS The maximum number of recorded edits
+template <size_t NUM_CHIPS, size_t MAX_COMMANDS> class CommandBuffer
+{
+public:
+  static_assert(NUM_CHIPS > 0, "CommandBuffer needs at least one chip");
+  static_assert(MAX_COMMANDS > 0 && MAX_COMMANDS <= UINT16_MAX, "CommandBuffer needs 1-65535 commands");
+
+  // @brief The number of bytes the buffer is executed on
+  static constexpr size_t m_size_bytes{NUM_CHIPS * chip_frame_size_bytes};
+
+  // @brief Record a 16-bit GS channel edit
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47
+  // @return false if either index is out of range or the buffer is full
+  bool set_greyscale(size_t chip_idx, size_t channel_idx, uint16_t pwm)
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return false;
+    }
+    return record(chip_offset(chip_idx) + FrameLayout::gs_data_offset + FrameLayout::gs_data_size * channel_idx, pwm,
+                  FrameLayout::gs_data_size);
+  }
+
+  // @brief Record the GS edits for the RGB channels of an LED
+  // @param led_idx Index of the LED in the chain. Must be value: 0 to (NUM_CHIPS * 16)-1
+  // @return false if led_idx is out of range or there is not space for all three edits
+  bool set_rgb(size_t led_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    if (!(led_idx < NUM_CHIPS * leds_per_chip) || (MAX_COMMANDS - m_num_commands) < colour_channels_per_led)
+    {
+      return false;
+    }
+    const size_t chip_idx      = led_idx / leds_per_chip;
+    const size_t first_channel = (led_idx % leds_per_chip) * colour_channels_per_led;
+    set_greyscale(chip_idx, first_channel + static_cast<size_t>(ColourChannel::blue), blue_pwm);
+    set_greyscale(chip_idx, first_channel + static_cast<size_t>(ColourChannel::green), green_pwm);
+    set_greyscale(chip_idx, first_channel + static_cast<size_t>(ColourChannel::red), red_pwm);
+    return true;
+  }
+
+  // @brief Record a DC edit
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47
+  // @param dc Must be value: 0-127
+  // @return false if either index is out of range or the buffer is full
+  bool set_dot_correction(size_t chip_idx, size_t channel_idx, uint8_t dc)
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return false;
+    }
+    return record(chip_offset(chip_idx) + FrameLayout::dc_data_offset + FrameLayout::dc_data_size * channel_idx, dc,
+                  FrameLayout::dc_data_size);
+  }
+
+  // @brief Record a BC edit
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param colour The colour channel
+  // @param bc Must be value: 0-127
+  // @return false if chip_idx is out of range or the buffer is full
+  bool set_global_brightness(size_t chip_idx, ColourChannel colour, uint8_t bc)
+  {
+    if (!(chip_idx < NUM_CHIPS))
+    {
+      return false;
+    }
+    return record(chip_offset(chip_idx) + FrameLayout::bc_data_offset + FrameLayout::bc_data_size * static_cast<size_t>(colour), bc,
+                  FrameLayout::bc_data_size);
+  }
+
+  // @brief Record an MC edit
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param colour The colour channel
+  // @param mc Must be value: 0-7
+  // @return false if chip_idx is out of range or the buffer is full
+  bool set_max_current(size_t chip_idx, ColourChannel colour, uint8_t mc)
+  {
+    if (!(chip_idx < NUM_CHIPS))
+    {
+      return false;
+    }
+    return record(chip_offset(chip_idx) + FrameLayout::mc_data_offset + FrameLayout::mc_data_size * static_cast<size_t>(colour), mc,
+                  FrameLayout::mc_data_size);
+  }
+
+  // @brief Record a function control edit. See Driver::set_function_cmd().
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @return false if chip_idx is out of range or the buffer is full
+  bool set_function(size_t chip_idx, Driver::DisplayFunction dsprpt, Driver::TimingFunction tmgrst, Driver::RefreshFunction rfresh,
+                    Driver::PwmFunction espwm, Driver::ShortDetectFunction lsdvlt)
+  {
+    if (!(chip_idx < NUM_CHIPS))
+    {
+      return false;
+    }
+    return record(chip_offset(chip_idx) + FrameLayout::func_cmd_offset, Driver::function_cmd_bits(dsprpt, tmgrst, rfresh, espwm, lsdvlt),
+                  FrameLayout::func_cmd_size);
+  }
+
+  // @brief Remove all recorded edits
+  void clear()
+  {
+    m_num_commands = 0;
+    m_num_writes   = 0;
+    m_prepared     = true;
+  }
+
+  // @brief Get the number of recorded edits
+  size_t size() const { return m_num_commands; }
+
+  // @brief Get the number of field writes left after coalescing edits to the same field
+  size_t get_num_writes()
+  {
+    prepare();
+    return m_num_writes;
+  }
+
+  // @brief Apply the edits to packed chip data. The buffer is kept, so it can be executed again.
+  // @param bytes The packed data. Must be NUM_CHIPS * 96 bytes.
+  // @return false if bytes is the wrong size
+  bool execute(std::span<uint8_t> bytes)
+  {
+    if (bytes.size() != m_size_bytes)
+    {
+      return false;
+    }
+    prepare();
+    for (size_t write_idx = 0; write_idx < m_num_writes; write_idx++)
+    {
+      const Command &command = m_commands[m_order[write_idx]];
+      write_frame_bits(bytes, command.bit_offset, command.value, command.num_bits);
+    }
+    return true;
+  }
+
+  // @brief Apply the edits to a GS frame. The buffer is kept, so it can be executed again.
+  bool execute(GreyscaleFrame<NUM_CHIPS> &frame) { return execute(frame.data()); }
+
+private:
+  // @brief One field edit
+  struct Command
+  {
+    uint32_t bit_offset;
+    uint16_t value;
+    uint8_t num_bits;
+  };
+
+  // @brief The edits in the order they were recorded
+  std::array<Command, MAX_COMMANDS> m_commands{};
+  // @brief Indices of the edits to write, sorted by offset and coalesced
+  std::array<uint16_t, MAX_COMMANDS> m_order{};
+  size_t m_num_commands{0};
+  size_t m_num_writes{0};
+  // @brief true when m_order is up to date
+  bool m_prepared{true};
+
+  // @brief The offset of a chip's first bit in the chain
+  static constexpr uint32_t chip_offset(size_t chip_idx) { return static_cast<uint32_t>(chip_idx * chip_frame_size_bytes * 8); }
+
+  bool record(uint32_t bit_offset, uint16_t value, uint8_t num_bits)
+  {
+    if (m_num_commands == MAX_COMMANDS)
+    {
+      return false;
+    }
+    m_commands[m_num_commands++] = Command{bit_offset, value, num_bits};
+    m_prepared                   = false;
+    return true;
+  }
+
+  // @brief Sort the edits by offset, keeping the last edit to each field
+  void prepare()
+  {
+    if (m_prepared)
+    {
+      return;
+    }
+    for (size_t command_idx = 0; command_idx < m_num_commands; command_idx++)
+    {
+      m_order[command_idx] = static_cast<uint16_t>(command_idx);
+    }
+    // the index breaks ties, so the last edit to a field is the last of its run
+    std::sort(m_order.begin(), m_order.begin() + m_num_commands, [this](uint16_t lhs, uint16_t rhs) {
+      return (m_commands[lhs].bit_offset != m_commands[rhs].bit_offset) ? (m_commands[lhs].bit_offset < m_commands[rhs].bit_offset)
+                                                                        : (lhs < rhs);
+    });
+    m_num_writes = 0;
+    for (size_t sorted_idx = 0; sorted_idx < m_num_commands; sorted_idx++)
+    {
+      const bool last_of_run = (sorted_idx + 1 == m_num_commands) ||
+                               (m_commands[m_order[sorted_idx + 1]].bit_offset != m_commands[m_order[sorted_idx]].bit_offset);
+      if (last_of_run)
+      {
+        m_order[m_num_writes++] = m_order[sorted_idx];
+      }
+    }
+    m_prepared = true;
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_COMMAND_BUFFER_HPP__
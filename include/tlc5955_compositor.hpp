@@ -0,0 +1,336 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_COMPOSITOR_HPP__
+#define __TLC5955_COMPOSITOR_HPP__
+
+#include <algorithm>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief How a layer's colour is combined with the layers below it, before the layer alpha is applied
+enum class BlendMode : uint8_t
+{
+  // @brief the layer colour replaces the colour below
+  normal,
+  // @brief the layer colour is added to the colour below, saturating at full scale
+  add,
+  // @brief the layer colour is multiplied by the colour below, e.g. for masks
+  multiply,
+  // @brief the inverse colours are multiplied, brightening the colour below
+  screen
+};
+
+// @brief A rectangle of LEDs. x is the column, y is the row.
+struct Rect
+{
+  uint16_t x{0};
+  uint16_t y{0};
+  uint16_t width{0};
+  uint16_t height{0};
+};
+
+// @brief Composites a fixed number of statically allocated layers into a GreyscaleFrame.
+// The LEDs form a WIDTH-wide grid in row-major chain order, i.e. LED index = y * WIDTH + x.
+// Layer 0 is the bottom layer. Each pixel has its own 8-bit coverage (0 is transparent) and each layer
+// has an 8-bit alpha and a blend mode.
+// Drawing marks a dirty rectangle and composite() only recomputes the LEDs inside it,
+// so a static background under a small status indicator costs only the indicator's pixels each frame.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+// @tparam NUM_LAYERS The number of layers
+// @tparam WIDTH The number of LEDs per row. Must divide the number of LEDs in the chain.
+template <size_t NUM_CHIPS, size_t NUM_LAYERS, size_t WIDTH> class Compositor
+{
+public:
+  static_assert(NUM_LAYERS > 0, "Compositor needs at least one layer");
+  static_assert(WIDTH > 0 && (GreyscaleFrame<NUM_CHIPS>::m_num_leds % WIDTH) == 0,
+                "WIDTH must divide the number of LEDs in the chain");
+
+  // @brief The number of LEDs in the chain
+  static constexpr size_t m_num_leds{GreyscaleFrame<NUM_CHIPS>::m_num_leds};
+  // @brief The number of LEDs per row
+  static constexpr size_t m_width{WIDTH};
+  // @brief The number of rows
+  static constexpr size_t m_height{m_num_leds / WIDTH};
+
+  // @brief Set one pixel of a layer
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param x Must be value: 0 to WIDTH-1
+  // @param y Must be value: 0 to m_height-1
+  // @param red_pwm Must be value: 0-2^16
+  // @param green_pwm Must be value: 0-2^16
+  // @param blue_pwm Must be value: 0-2^16
+  // @param coverage 0 is transparent, 255 is opaque
+  // @return false if any index is out of range
+  bool set_pixel(size_t layer_idx, size_t x, size_t y, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm,
+                 uint8_t coverage = 255)
+  {
+    if (!(x < WIDTH) || !(y < m_height))
+    {
+      return false;
+    }
+    return fill_rect(layer_idx, Rect{static_cast<uint16_t>(x), static_cast<uint16_t>(y), 1, 1}, red_pwm, green_pwm,
+                     blue_pwm, coverage);
+  }
+
+  // @brief Fill a rectangle of a layer. The rectangle is clipped to the grid.
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param rect The rectangle to fill
+  // @param red_pwm Must be value: 0-2^16
+  // @param green_pwm Must be value: 0-2^16
+  // @param blue_pwm Must be value: 0-2^16
+  // @param coverage 0 is transparent, 255 is opaque
+  // @return false if the layer is out of range or the rectangle is empty after clipping
+  bool fill_rect(size_t layer_idx, Rect rect, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm,
+                 uint8_t coverage = 255)
+  {
+    if (!(layer_idx < NUM_LAYERS) || !clip(rect))
+    {
+      return false;
+    }
+    Layer &layer = m_layers[layer_idx];
+    for (size_t y = rect.y; y < static_cast<size_t>(rect.y + rect.height); y++)
+    {
+      for (size_t x = rect.x; x < static_cast<size_t>(rect.x + rect.width); x++)
+      {
+        const size_t led_idx    = y * WIDTH + x;
+        uint16_t *const led_pwm = &layer.colour[led_idx * colour_channels_per_led];
+        led_pwm[static_cast<size_t>(ColourChannel::blue)]  = blue_pwm;
+        led_pwm[static_cast<size_t>(ColourChannel::green)] = green_pwm;
+        led_pwm[static_cast<size_t>(ColourChannel::red)]   = red_pwm;
+        layer.coverage[led_idx] = coverage;
+      }
+    }
+    // the content bounds only grow, so they always cover every non-transparent pixel
+    if (coverage > 0)
+    {
+      unite(layer.bounds, rect);
+    }
+    unite(m_dirty, rect);
+    return true;
+  }
+
+  // @brief Make a rectangle of a layer transparent
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param rect The rectangle to clear
+  // @return false if the layer is out of range or the rectangle is empty after clipping
+  bool clear_rect(size_t layer_idx, Rect rect) { return fill_rect(layer_idx, rect, 0, 0, 0, 0); }
+
+  // @brief Make a whole layer transparent
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @return false if the layer is out of range
+  bool clear_layer(size_t layer_idx)
+  {
+    if (!(layer_idx < NUM_LAYERS))
+    {
+      return false;
+    }
+    Layer &layer = m_layers[layer_idx];
+    layer.colour.fill(0);
+    layer.coverage.fill(0);
+    unite(m_dirty, layer.bounds);
+    layer.bounds = Rect{};
+    return true;
+  }
+
+  // @brief Set the alpha of a layer
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param alpha 0 is transparent, 255 is opaque
+  // @return false if the layer is out of range
+  bool set_alpha(size_t layer_idx, uint8_t alpha)
+  {
+    if (!(layer_idx < NUM_LAYERS))
+    {
+      return false;
+    }
+    if (m_layers[layer_idx].alpha != alpha)
+    {
+      m_layers[layer_idx].alpha = alpha;
+      unite(m_dirty, m_layers[layer_idx].bounds);
+    }
+    return true;
+  }
+
+  // @brief Set the blend mode of a layer
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param mode The blend mode
+  // @return false if the layer is out of range
+  bool set_blend_mode(size_t layer_idx, BlendMode mode)
+  {
+    if (!(layer_idx < NUM_LAYERS))
+    {
+      return false;
+    }
+    if (m_layers[layer_idx].mode != mode)
+    {
+      m_layers[layer_idx].mode = mode;
+      unite(m_dirty, m_layers[layer_idx].bounds);
+    }
+    return true;
+  }
+
+  // @brief Show or hide a layer
+  // @param layer_idx Must be value: 0 to NUM_LAYERS-1
+  // @param visible false to skip the layer
+  // @return false if the layer is out of range
+  bool set_visible(size_t layer_idx, bool visible)
+  {
+    if (!(layer_idx < NUM_LAYERS))
+    {
+      return false;
+    }
+    if (m_layers[layer_idx].visible != visible)
+    {
+      m_layers[layer_idx].visible = visible;
+      unite(m_dirty, m_layers[layer_idx].bounds);
+    }
+    return true;
+  }
+
+  // @brief Mark the whole grid dirty, e.g. when out was written by something else
+  void invalidate() { m_dirty = Rect{0, 0, static_cast<uint16_t>(WIDTH), static_cast<uint16_t>(m_height)}; }
+
+  // @brief Get the rectangle that the next composite() will recompute
+  Rect get_dirty_rect() const { return m_dirty; }
+
+  // @brief Composite the dirty rectangle into a frame, then clear it.
+  // LEDs outside the dirty rectangle are not touched, so out must hold the result of the previous composite().
+  // @param out The frame to update, e.g. the one passed to Driver::send_frame()
+  // @return true if any LEDs were recomputed
+  bool composite(GreyscaleFrame<NUM_CHIPS> &out)
+  {
+    if (m_dirty.width == 0 || m_dirty.height == 0)
+    {
+      return false;
+    }
+    for (size_t y = m_dirty.y; y < static_cast<size_t>(m_dirty.y + m_dirty.height); y++)
+    {
+      for (size_t x = m_dirty.x; x < static_cast<size_t>(m_dirty.x + m_dirty.width); x++)
+      {
+        composite_led(y * WIDTH + x, out);
+      }
+    }
+    m_dirty = Rect{};
+    return true;
+  }
+
+private:
+  // @brief The storage and settings for one layer
+  struct Layer
+  {
+    // @brief 16-bit colours in GS channel order
+    std::array<uint16_t, m_num_leds * colour_channels_per_led> colour{};
+    // @brief per-pixel coverage: 0 is transparent, 255 is opaque
+    std::array<uint8_t, m_num_leds> coverage{};
+    // @brief covers every pixel with non-zero coverage
+    Rect bounds{};
+    // @brief 0 is transparent, 255 is opaque
+    uint8_t alpha{255};
+    BlendMode mode{BlendMode::normal};
+    bool visible{true};
+  };
+
+  // @brief The layers, bottom first
+  std::array<Layer, NUM_LAYERS> m_layers{};
+  // @brief The rectangle to recompute on the next composite()
+  Rect m_dirty{0, 0, static_cast<uint16_t>(WIDTH), static_cast<uint16_t>(m_height)};
+
+  // @brief Clip a rectangle to the grid
+  // @return false if the clipped rectangle is empty
+  static bool clip(Rect &rect)
+  {
+    if (!(rect.x < WIDTH) || !(rect.y < m_height))
+    {
+      return false;
+    }
+    rect.width  = static_cast<uint16_t>(std::min<size_t>(rect.width, WIDTH - rect.x));
+    rect.height = static_cast<uint16_t>(std::min<size_t>(rect.height, m_height - rect.y));
+    return rect.width > 0 && rect.height > 0;
+  }
+
+  // @brief Grow a rectangle to cover another one
+  static void unite(Rect &rect, const Rect &other)
+  {
+    if (other.width == 0 || other.height == 0)
+    {
+      return;
+    }
+    if (rect.width == 0 || rect.height == 0)
+    {
+      rect = other;
+      return;
+    }
+    const uint16_t x0 = std::min(rect.x, other.x);
+    const uint16_t y0 = std::min(rect.y, other.y);
+    const uint16_t x1 = static_cast<uint16_t>(std::max(rect.x + rect.width, other.x + other.width));
+    const uint16_t y1 = static_cast<uint16_t>(std::max(rect.y + rect.height, other.y + other.height));
+    rect              = Rect{x0, y0, static_cast<uint16_t>(x1 - x0), static_cast<uint16_t>(y1 - y0)};
+  }
+
+  // @brief Combine a layer colour with the colour below it
+  static uint32_t blend(BlendMode mode, uint32_t below, uint32_t layer)
+  {
+    switch (mode)
+    {
+      case BlendMode::add:
+        return std::min<uint32_t>(below + layer, 0xFFFF);
+      case BlendMode::multiply:
+        return (below * layer + 0xFFFF) >> 16;
+      case BlendMode::screen:
+        return 0xFFFF - (((0xFFFF - below) * (0xFFFF - layer) + 0xFFFF) >> 16);
+      case BlendMode::normal:
+      default:
+        return layer;
+    }
+  }
+
+  // @brief Composite all layers for one LED
+  void composite_led(size_t led_idx, GreyscaleFrame<NUM_CHIPS> &out) const
+  {
+    std::array<uint32_t, colour_channels_per_led> pwm{0, 0, 0};
+    for (const Layer &layer : m_layers)
+    {
+      if (!layer.visible || layer.coverage[led_idx] == 0 || layer.alpha == 0)
+      {
+        continue;
+      }
+      // Q8 weight, 0 to 256, as used by crossfade()
+      const uint32_t opacity = (static_cast<uint32_t>(layer.alpha) * layer.coverage[led_idx] + 127) / 255;
+      const uint32_t weight  = opacity + (opacity >> 7);
+      for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+      {
+        const uint32_t blended = blend(layer.mode, pwm[colour_idx], layer.colour[led_idx * colour_channels_per_led + colour_idx]);
+        pwm[colour_idx]        = (pwm[colour_idx] * (256 - weight) + blended * weight) >> 8;
+      }
+    }
+    out.set_rgb(led_idx, static_cast<uint16_t>(pwm[static_cast<size_t>(ColourChannel::red)]),
+                static_cast<uint16_t>(pwm[static_cast<size_t>(ColourChannel::green)]),
+                static_cast<uint16_t>(pwm[static_cast<size_t>(ColourChannel::blue)]));
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_COMPOSITOR_HPP__
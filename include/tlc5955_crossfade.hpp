@@ -0,0 +1,81 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_CROSSFADE_HPP__
+#define __TLC5955_CROSSFADE_HPP__
+
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief The crossfade weight that gives the "to" frame. Weights are Q8: 0 to 256.
+inline constexpr uint16_t crossfade_weight_max{256};
+
+// @brief Get the crossfade weight for one step of a fade
+// @param step The current step: 0 to num_steps
+// @param num_steps The number of steps in the fade
+// @return uint16_t The weight: 0 to crossfade_weight_max
+constexpr uint16_t crossfade_weight(uint32_t step, uint32_t num_steps)
+{
+  if (num_steps == 0 || step >= num_steps)
+  {
+    return crossfade_weight_max;
+  }
+  return static_cast<uint16_t>((static_cast<uint64_t>(step) * crossfade_weight_max) / num_steps);
+}
+
+// @brief Interpolate two packed GS frames channel by channel, without unpacking them:
+// out = (from * (256 - weight) + to * weight) / 256, rounded down.
+// The output can be the transmit buffer (e.g. from a PipelinedSender pack function) or one of the inputs.
+// 32-bit targets blend two channels per word (SWAR) when all three buffers are word aligned;
+// other targets use a loop the compiler can auto-vectorise. Both give identical results.
+// @param from The frame at weight 0
+// @param to The frame at weight crossfade_weight_max
+// @param weight Must be value: 0 to crossfade_weight_max. Larger values are clamped.
+// @param out The blended frame
+// @return false if the buffers are not all the same even size
+bool crossfade(std::span<const uint8_t> from, std::span<const uint8_t> to, uint16_t weight, std::span<uint8_t> out);
+
+// @brief Interpolate two greyscale frames. See crossfade() above.
+template <size_t NUM_CHIPS>
+void crossfade(const GreyscaleFrame<NUM_CHIPS> &from, const GreyscaleFrame<NUM_CHIPS> &to, uint16_t weight,
+               GreyscaleFrame<NUM_CHIPS> &out)
+{
+  crossfade(from.data(), to.data(), weight, out.data());
+}
+
+namespace detail
+{
+
+// @brief Blend num_channels big-endian 16-bit channels one at a time
+void crossfade_channels(const uint8_t *from, const uint8_t *to, uint16_t weight, uint8_t *out, size_t num_channels);
+
+// @brief Blend num_words word-aligned 32-bit words, two channels per word
+void crossfade_words(const uint8_t *from, const uint8_t *to, uint16_t weight, uint8_t *out, size_t num_words);
+
+} // namespace detail
+
+} // namespace tlc5955
+
+#endif // __TLC5955_CROSSFADE_HPP__
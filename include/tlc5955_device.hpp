@@ -93,6 +93,20 @@ public:
   uint32_t get_rcc_gpio_clk() { return m_rcc_gpio_clk; }
   uint32_t get_rcc_spi_clk() { return m_rcc_spi_clk; }
 
+  // @brief Connect the SPI MISO pin to SOUT of the chip at the end of the chain (chip 0) for fault readback.
+  // The SPI then runs full-duplex instead of TX-only. Must be on the same GPIO clock as MOSI/SCK.
+  // @param miso_gpio The MISO port+pin e.g. GPIOB, LL_GPIO_PIN_6
+  // @param miso_af The MISO alternate function e.g. LL_GPIO_AF_4
+  void set_miso(std::pair<GPIO_TypeDef *, uint16_t> miso_gpio, uint32_t miso_af)
+  {
+    m_miso_port = miso_gpio.first;
+    m_miso_pin  = miso_gpio.second;
+    m_miso_af   = miso_af;
+  }
+  GPIO_TypeDef *get_miso_port() { return m_miso_port; }
+  uint16_t get_miso_pin() { return m_miso_pin; }
+  uint32_t get_miso_af() { return m_miso_af; }
+
 private:
   // @brief The SPI peripheral
   SPI_TypeDef &m_led_spi;
@@ -116,6 +130,12 @@ private:
   uint32_t m_rcc_gpio_clk;
   // @brief Used to enable the SPI clock for MOSI and SCK pins (for writing 96 bytes data)
   uint32_t m_rcc_spi_clk;
+  // @brief The MISO GPIO port, or nullptr for TX-only SPI
+  GPIO_TypeDef *m_miso_port{nullptr};
+  // @brief The MISO GPIO pin
+  uint16_t m_miso_pin{0};
+  // @brief The MISO alternate function
+  uint32_t m_miso_af{0};
 };
 
 } // namespace tlc5955
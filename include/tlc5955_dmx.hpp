@@ -0,0 +1,213 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_DMX_HPP__
+#define __TLC5955_DMX_HPP__
+
+#include <span>
+#include <tlc5955_frame.hpp>
+#include <tlc5955_gamma.hpp>
+
+namespace tlc5955
+{
+
+// @brief How the DMX slots of a universe encode each LED
+enum class DmxSlotFormat : uint8_t
+{
+  // @brief 3 slots per LED, 8-bit levels passed through the gamma table
+  rgb8,
+  // @brief 6 slots per LED, 16-bit levels (coarse slot then fine slot)
+  rgb16
+};
+
+// @brief The order of the colour slots for each LED
+enum class DmxColourOrder : uint8_t
+{
+  rgb,
+  grb,
+  bgr
+};
+
+// @brief Maps a run of slots in one DMX universe onto a run of LEDs in the chain
+struct DmxUniverseMap
+{
+  // @brief The Art-Net port address (0-32767) or sACN universe (1-63999)
+  uint16_t universe{0};
+  // @brief The first slot used in the universe (0-511, not counting the start code)
+  uint16_t first_slot{0};
+  // @brief The chain LED index that the first slot maps to
+  uint32_t first_led{0};
+  // @brief The number of LEDs to map
+  uint16_t num_leds{0};
+  // @brief 8 or 16-bit levels
+  DmxSlotFormat format{DmxSlotFormat::rgb8};
+  // @brief The order of the colour slots
+  DmxColourOrder order{DmxColourOrder::rgb};
+};
+
+// @brief Decodes Art-Net (ArtDmx/ArtSync) and E1.31 sACN (data/sync) packets straight into packed GS data.
+// DMX levels are written into the chain byte image (see GreyscaleFrame) with no intermediate pixel buffer.
+//
+// Until the first sync packet is seen every DMX packet marks the frame ready. After that only sync packets do,
+// so the chain is latched once per sync as the sources intended. The sync address last received for each
+// mapped universe is kept: an sACN sync only marks the frame ready if it matches one of them, ArtSync matches
+// the universes received over Art-Net, and sACN data with sync address 0 is always latched straight away.
+class DmxDecoder
+{
+public:
+  // @brief The type of packet decoded
+  enum class Packet
+  {
+    // @brief not Art-Net or sACN, or truncated
+    invalid,
+    // @brief DMX data for a mapped universe
+    dmx,
+    // @brief Art-Net or sACN universe sync
+    sync,
+    // @brief valid but not used (e.g. unmapped universe, non-zero start code, preview data)
+    ignored
+  };
+
+  // @brief Construct a new Dmx Decoder object
+  // @param gs_bytes The chain GS data to write to e.g. GreyscaleFrame::data()
+  // @param universe_map The mapping, sorted by universe. A universe may have several entries.
+  // Only the first m_max_map_entries entries are used.
+  // @param gamma The table for 8-bit levels
+  DmxDecoder(std::span<uint8_t> gs_bytes, std::span<const DmxUniverseMap> universe_map, const GammaTable &gamma = gamma_table_2_2);
+
+  // @brief Decode one UDP payload
+  // @param packet The UDP payload
+  // @return Packet The type of packet
+  Packet decode(std::span<const uint8_t> packet);
+
+  // @brief Check if a new frame should be sent and latched. Clears the flag.
+  bool take_frame_ready();
+
+  // @brief The number of DMX packets written into the GS data
+  uint32_t get_dmx_packet_count() const { return m_dmx_packet_count; }
+
+  // @brief Art-Net UDP port
+  static constexpr uint16_t m_artnet_port{6454};
+  // @brief sACN UDP port
+  static constexpr uint16_t m_sacn_port{5568};
+  // @brief The max number of universe map entries
+  static constexpr size_t m_max_map_entries{512};
+
+private:
+  // @brief The chain GS data
+  std::span<uint8_t> m_gs_bytes;
+  // @brief Sorted universe mapping
+  std::span<const DmxUniverseMap> m_universe_map;
+  // @brief The table for 8-bit levels
+  const GammaTable &m_gamma;
+  // @brief Set once a sync packet has been seen
+  bool m_sync_mode{false};
+  // @brief Set when the GS data should be sent
+  bool m_frame_ready{false};
+  // @brief The number of DMX packets written into the GS data
+  uint32_t m_dmx_packet_count{0};
+  // @brief The sync address last received for each universe map entry
+  std::array<uint16_t, m_max_map_entries> m_sync_addresses{};
+
+  // @brief Decode an Art-Net packet
+  Packet decode_artnet(std::span<const uint8_t> packet);
+  // @brief Decode an E1.31 packet
+  Packet decode_sacn(std::span<const uint8_t> packet);
+  // @brief Handle a sync packet
+  // @param sync_address The sACN sync address, or the Art-Net sync address for ArtSync
+  Packet sync(uint16_t sync_address);
+  // @brief Write the slots of a universe into the GS data
+  // @param sync_address The sACN sync address (0 if not synchronized), or the Art-Net sync address for ArtDmx
+  Packet write_universe(uint16_t universe, std::span<const uint8_t> slots, uint16_t sync_address);
+  // @brief Write the slots of one mapping entry into the GS data
+  void write_mapping(const DmxUniverseMap &mapping, std::span<const uint8_t> slots);
+};
+
+} // namespace tlc5955
+
+#if defined(__linux__)
+
+  #include <netinet/in.h>
+  #include <sys/socket.h>
+
+namespace tlc5955
+{
+
+// @brief Receives Art-Net or sACN over UDP and feeds a DmxDecoder.
+// Packets are read in batches with recvmmsg() so hundreds of universes per frame cost a few syscalls.
+class DmxUdpReceiver
+{
+public:
+  // @brief Construct a new Dmx Udp Receiver object
+  // @param decoder The decoder to feed
+  explicit DmxUdpReceiver(DmxDecoder &decoder);
+
+  ~DmxUdpReceiver() { close(); }
+
+  DmxUdpReceiver(const DmxUdpReceiver &)            = delete;
+  DmxUdpReceiver &operator=(const DmxUdpReceiver &) = delete;
+
+  // @brief Bind the UDP socket
+  // @param port e.g. DmxDecoder::m_artnet_port or DmxDecoder::m_sacn_port. 0 picks a free port.
+  // @param bind_address The local address in host byte order e.g. INADDR_ANY or INADDR_LOOPBACK
+  // @return false if the socket could not be bound
+  bool open(uint16_t port, uint32_t bind_address = INADDR_ANY);
+
+  // @brief Join the sACN multicast group of a universe (239.255.hi.lo)
+  // @return false if the group could not be joined
+  bool join_sacn_universe(uint16_t universe);
+
+  // @brief Close the socket
+  void close();
+
+  // @brief The bound UDP port, or 0 if the socket is not open
+  uint16_t get_port() const;
+
+  // @brief Wait for packets and decode all that are available, in batches
+  // @param timeout_ms How long to wait for the first packet. 0 does not wait.
+  // @return int The number of packets decoded, or -1 on error
+  int receive(int timeout_ms);
+
+  // @brief The max number of packets read per recvmmsg() call
+  static constexpr size_t m_batch_size{32};
+  // @brief The largest sACN packet (Art-Net packets are smaller)
+  static constexpr size_t m_max_packet_size{638};
+
+private:
+  // @brief The decoder to feed
+  DmxDecoder &m_decoder;
+  // @brief The socket file descriptor
+  int m_fd{-1};
+  // @brief Receive buffers
+  std::array<std::array<uint8_t, m_max_packet_size>, m_batch_size> m_buffers{};
+  // @brief recvmmsg() scatter/gather
+  std::array<iovec, m_batch_size> m_iovecs{};
+  // @brief recvmmsg() headers
+  std::array<mmsghdr, m_batch_size> m_headers{};
+};
+
+} // namespace tlc5955
+
+#endif // __linux__
+
+#endif // __TLC5955_DMX_HPP__
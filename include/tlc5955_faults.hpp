@@ -0,0 +1,148 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_FAULTS_HPP__
+#define __TLC5955_FAULTS_HPP__
+
+#include <bit>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief LED open (LOD), LED short (LSD) and thermal shutdown (TSD) flags for a chain, decoded from the
+// status information data (SID) that the chips shift out of SOUT while the next frame is sent.
+// The SID is loaded into the common shift register at the LAT rising edge of a GS data write,
+// so pass the SOUT bytes captured by Driver::send_frame() for the frame after that GS latch.
+//
+// SID bits 0-47 are LOD, 48-95 are LSD and 96 is TSD. With the frame byte order, LOD is in bytes 90-95
+// and LSD in bytes 84-89, most significant bit first in GS channel order, so each chip decodes as 12 byte copies.
+// LOD is only valid for outputs that were on (non-zero GS) when the SID was loaded.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class FaultBitmap
+{
+public:
+  // @brief The number of bitmap bytes per chip for LOD or LSD
+  static constexpr size_t m_bytes_per_chip{gs_channels_per_chip / 8};
+  // @brief The first SOUT byte of the LSD bits
+  static constexpr size_t m_lsd_offset{84};
+  // @brief The first SOUT byte of the LOD bits
+  static constexpr size_t m_lod_offset{90};
+  // @brief The SOUT byte and bit mask of the TSD bit
+  static constexpr size_t m_tsd_offset{83};
+  static constexpr uint8_t m_tsd_mask{0x01};
+
+  // @brief Decode the SOUT bytes for the whole chain
+  // @param sout The bytes captured by Driver::send_frame(), 96 per chip
+  // @return false if sout is the wrong size
+  bool decode(std::span<const uint8_t> sout)
+  {
+    if (sout.size() != NUM_CHIPS * chip_frame_size_bytes)
+    {
+      return false;
+    }
+    for (size_t chip_idx = 0; chip_idx < NUM_CHIPS; chip_idx++)
+    {
+      const uint8_t *chip_sout = sout.data() + chip_idx * chip_frame_size_bytes;
+      for (size_t byte_idx = 0; byte_idx < m_bytes_per_chip; byte_idx++)
+      {
+        m_lod[chip_idx * m_bytes_per_chip + byte_idx] = chip_sout[m_lod_offset + byte_idx];
+        m_lsd[chip_idx * m_bytes_per_chip + byte_idx] = chip_sout[m_lsd_offset + byte_idx];
+      }
+      if ((chip_sout[m_tsd_offset] & m_tsd_mask) != 0)
+      {
+        m_tsd_chips[chip_idx / 8] = static_cast<uint8_t>(m_tsd_chips[chip_idx / 8] | (0x80 >> (chip_idx % 8)));
+      }
+      else
+      {
+        m_tsd_chips[chip_idx / 8] = static_cast<uint8_t>(m_tsd_chips[chip_idx / 8] & ~(0x80 >> (chip_idx % 8)));
+      }
+    }
+    return true;
+  }
+
+  // @brief Check if an output is open
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47, in GS channel order
+  bool is_open(size_t chip_idx, size_t channel_idx) const { return test(m_lod, chip_idx, channel_idx); }
+
+  // @brief Check if an output is shorted
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47, in GS channel order
+  bool is_shorted(size_t chip_idx, size_t channel_idx) const { return test(m_lsd, chip_idx, channel_idx); }
+
+  // @brief Check if a chip reported thermal shutdown
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  bool is_overheated(size_t chip_idx) const
+  {
+    return (chip_idx < NUM_CHIPS) && (m_tsd_chips[chip_idx / 8] & (0x80 >> (chip_idx % 8))) != 0;
+  }
+
+  // @brief The number of open outputs in the chain
+  size_t count_open() const { return count(m_lod); }
+
+  // @brief The number of shorted outputs in the chain
+  size_t count_shorted() const { return count(m_lsd); }
+
+  // @brief Check if any fault is flagged anywhere in the chain
+  bool has_faults() const { return count_open() != 0 || count_shorted() != 0 || count(m_tsd_chips) != 0; }
+
+  // @brief The LOD bitmap: 6 bytes per chip, channel 0 in the most significant bit
+  std::span<const uint8_t> open_bitmap() const { return m_lod; }
+
+  // @brief The LSD bitmap: 6 bytes per chip, channel 0 in the most significant bit
+  std::span<const uint8_t> short_bitmap() const { return m_lsd; }
+
+private:
+  // @brief LED open flags
+  std::array<uint8_t, NUM_CHIPS * m_bytes_per_chip> m_lod{};
+  // @brief LED short flags
+  std::array<uint8_t, NUM_CHIPS * m_bytes_per_chip> m_lsd{};
+  // @brief thermal shutdown flags, chip 0 in the most significant bit
+  std::array<uint8_t, (NUM_CHIPS + 7) / 8> m_tsd_chips{};
+
+  // @brief Check one channel's flag in a bitmap
+  template <size_t SIZE> static bool test(const std::array<uint8_t, SIZE> &bitmap, size_t chip_idx, size_t channel_idx)
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return false;
+    }
+    return (bitmap[chip_idx * m_bytes_per_chip + channel_idx / 8] & (0x80 >> (channel_idx % 8))) != 0;
+  }
+
+  // @brief Count the flags set in a bitmap
+  template <size_t SIZE> static size_t count(const std::array<uint8_t, SIZE> &bitmap)
+  {
+    size_t total = 0;
+    for (const uint8_t byte : bitmap)
+    {
+      total += static_cast<size_t>(std::popcount(byte));
+    }
+    return total;
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_FAULTS_HPP__
@@ -0,0 +1,249 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_FRAME_HPP__
+#define __TLC5955_FRAME_HPP__
+
+#include <array>
+#include <span>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace tlc5955
+{
+
+// @brief The number of bytes shifted into each chip (excluding the first bit)
+inline constexpr size_t chip_frame_size_bytes{96};
+// @brief The number of LEDs per driver chip
+inline constexpr uint8_t leds_per_chip{16};
+// @brief The number of colour channels per LED
+inline constexpr uint8_t colour_channels_per_led{3};
+// @brief The number of 16-bit GS channels per driver chip
+inline constexpr uint8_t gs_channels_per_chip{leds_per_chip * colour_channels_per_led};
+
+// @brief The alignment of frame data sent from memory, e.g. by DMA or 32-bit accesses
+inline constexpr size_t frame_store_alignment{4};
+
+// @brief The bit layout of the data shifted into each chip (excluding the first bit), the same as the Driver
+// common register. Offsets are in bits from the start of the chip's bytes, most significant bit first.
+struct FrameLayout
+{
+  // @brief The control command. Always 0x96 (0b10010110)
+  static constexpr uint8_t ctrl_cmd{0x96};
+  // @brief bits per ctrl command
+  static constexpr size_t ctrl_cmd_size{8};
+  // @brief bits per function command
+  static constexpr size_t func_cmd_size{5};
+  // @brief bits per brightness control data
+  static constexpr size_t bc_data_size{7};
+  // @brief bits per max current data
+  static constexpr size_t mc_data_size{3};
+  // @brief bits per dot correction data
+  static constexpr size_t dc_data_size{7};
+  // @brief bits per greyscale data
+  static constexpr size_t gs_data_size{16};
+
+  // @brief control command latch offset
+  static constexpr size_t ctrl_cmd_offset{0};
+  // @brief function command latch offset. The padding before it ends with a 1 bit.
+  static constexpr size_t func_cmd_offset{chip_frame_size_bytes * 8 -
+                                          (func_cmd_size + (bc_data_size + mc_data_size) * colour_channels_per_led +
+                                           dc_data_size * gs_channels_per_chip)};
+  // @brief brightness control data latch offset
+  static constexpr size_t bc_data_offset{func_cmd_offset + func_cmd_size};
+  // @brief max current data latch offset
+  static constexpr size_t mc_data_offset{bc_data_offset + bc_data_size * colour_channels_per_led};
+  // @brief dot correction data latch offset
+  static constexpr size_t dc_data_offset{mc_data_offset + mc_data_size * colour_channels_per_led};
+  // @brief greyscale data latch offset
+  static constexpr size_t gs_data_offset{0};
+};
+
+// @brief The order of the colour channels within each LED
+enum class ColourChannel : uint8_t
+{
+  blue  = 0,
+  green = 1,
+  red   = 2
+};
+
+// @brief Write a field into packed chip data, most significant bit first in the order it is shifted out.
+// The other bits are left unchanged.
+// @param bytes The packed data, e.g. GreyscaleFrame::data()
+// @param bit_offset The offset of the field's first bit from the start of bytes
+// @param value The field value. Bits above num_bits are ignored.
+// @param num_bits The width of the field: 1-16
+inline void write_frame_bits(std::span<uint8_t> bytes, size_t bit_offset, uint16_t value, size_t num_bits)
+{
+  if ((bit_offset % 8) == 0 && num_bits == 16)
+  {
+    // byte aligned GS channel
+    bytes[bit_offset / 8]     = static_cast<uint8_t>(value >> 8);
+    bytes[bit_offset / 8 + 1] = static_cast<uint8_t>(value & 0xFF);
+    return;
+  }
+  for (size_t bit_idx = 0; bit_idx < num_bits; bit_idx++)
+  {
+    const size_t stream_bit = bit_offset + bit_idx;
+    const uint8_t mask      = static_cast<uint8_t>(0x80 >> (stream_bit % 8));
+    if (((value >> (num_bits - 1 - bit_idx)) & 0x1) != 0)
+    {
+      bytes[stream_bit / 8] = static_cast<uint8_t>(bytes[stream_bit / 8] | mask);
+    }
+    else
+    {
+      bytes[stream_bit / 8] = static_cast<uint8_t>(bytes[stream_bit / 8] & ~mask);
+    }
+  }
+}
+
+// @brief Packed GS latch data for a daisy chain of TLC5955, in the byte format sent over SPI.
+// Chip 0 is shifted first so ends up in the chip furthest from the MCU.
+// Each chip has the same layout as the Driver common register: 48 big-endian 16-bit channels in the order
+// LED0 blue, LED0 green, LED0 red, LED1 blue ... LED15 red.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class GreyscaleFrame
+{
+public:
+  static_assert(NUM_CHIPS > 0, "GreyscaleFrame needs at least one chip");
+
+  // @brief The number of daisy-chained chips
+  static constexpr size_t m_num_chips{NUM_CHIPS};
+  // @brief The number of LEDs in the chain
+  static constexpr size_t m_num_leds{NUM_CHIPS * leds_per_chip};
+  // @brief The number of bytes in the frame
+  static constexpr size_t m_size_bytes{NUM_CHIPS * chip_frame_size_bytes};
+
+  // @brief Set one 16-bit GS channel
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47
+  // @param pwm Must be value: 0-2^16
+  // @return false if either index is out of range
+  bool set_channel(size_t chip_idx, size_t channel_idx, uint16_t pwm)
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return false;
+    }
+    write_channel(chip_idx * gs_channels_per_chip + channel_idx, pwm);
+    return true;
+  }
+
+  // @brief Get one 16-bit GS channel
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  // @param channel_idx Must be value: 0-47
+  // @return uint16_t The PWM value, or 0 if either index is out of range
+  uint16_t get_channel(size_t chip_idx, size_t channel_idx) const
+  {
+    if (!(chip_idx < NUM_CHIPS) || !(channel_idx < gs_channels_per_chip))
+    {
+      return 0;
+    }
+    return read_channel(chip_idx * gs_channels_per_chip + channel_idx);
+  }
+
+  // @brief Set the RGB channels of an LED
+  // @param led_idx Index of the LED in the chain. Must be value: 0 to (NUM_CHIPS * 16)-1
+  // @param red_pwm Must be value: 0-2^16
+  // @param green_pwm Must be value: 0-2^16
+  // @param blue_pwm Must be value: 0-2^16
+  // @return false if led_idx is out of range
+  bool set_rgb(size_t led_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    if (!(led_idx < m_num_leds))
+    {
+      return false;
+    }
+    const size_t first_channel = led_idx * colour_channels_per_led;
+    write_channel(first_channel + static_cast<size_t>(ColourChannel::blue), blue_pwm);
+    write_channel(first_channel + static_cast<size_t>(ColourChannel::green), green_pwm);
+    write_channel(first_channel + static_cast<size_t>(ColourChannel::red), red_pwm);
+    return true;
+  }
+
+  // @brief Get one colour channel of an LED
+  // @param led_idx Index of the LED in the chain. Must be value: 0 to (NUM_CHIPS * 16)-1
+  // @param colour The colour channel
+  // @return uint16_t The PWM value, or 0 if led_idx is out of range
+  uint16_t get_colour(size_t led_idx, ColourChannel colour) const
+  {
+    if (!(led_idx < m_num_leds))
+    {
+      return 0;
+    }
+    return read_channel(led_idx * colour_channels_per_led + static_cast<size_t>(colour));
+  }
+
+  // @brief Set all LEDs in the chain to the same colour
+  void fill_rgb(uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    for (size_t led_idx = 0; led_idx < m_num_leds; led_idx++)
+    {
+      set_rgb(led_idx, red_pwm, green_pwm, blue_pwm);
+    }
+  }
+
+  // @brief Set all channels to zero
+  void clear() { m_bytes.fill(0); }
+
+  // @brief Get the bytes for one chip
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  std::span<uint8_t, chip_frame_size_bytes> chip(size_t chip_idx)
+  {
+    return std::span<uint8_t, chip_frame_size_bytes>(m_bytes.data() + chip_idx * chip_frame_size_bytes, chip_frame_size_bytes);
+  }
+
+  // @brief Get the bytes for one chip
+  // @param chip_idx Must be value: 0 to NUM_CHIPS-1
+  std::span<const uint8_t, chip_frame_size_bytes> chip(size_t chip_idx) const
+  {
+    return std::span<const uint8_t, chip_frame_size_bytes>(m_bytes.data() + chip_idx * chip_frame_size_bytes, chip_frame_size_bytes);
+  }
+
+  // @brief Get the bytes for the whole chain
+  std::span<uint8_t, m_size_bytes> data() { return m_bytes; }
+
+  // @brief Get the bytes for the whole chain
+  std::span<const uint8_t, m_size_bytes> data() const { return m_bytes; }
+
+private:
+  // @brief The packed frame. Word aligned so crossfade() can use 32-bit accesses.
+  alignas(frame_store_alignment) std::array<uint8_t, m_size_bytes> m_bytes{0};
+
+  // @brief Write a channel by its index in the chain
+  void write_channel(size_t chain_channel_idx, uint16_t pwm)
+  {
+    m_bytes[chain_channel_idx * 2]     = static_cast<uint8_t>(pwm >> 8);
+    m_bytes[chain_channel_idx * 2 + 1] = static_cast<uint8_t>(pwm & 0xFF);
+  }
+
+  // @brief Read a channel by its index in the chain
+  uint16_t read_channel(size_t chain_channel_idx) const
+  {
+    return static_cast<uint16_t>((m_bytes[chain_channel_idx * 2] << 8) | m_bytes[chain_channel_idx * 2 + 1]);
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_FRAME_HPP__
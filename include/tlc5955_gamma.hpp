@@ -0,0 +1,114 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_GAMMA_HPP__
+#define __TLC5955_GAMMA_HPP__
+
+#include <array>
+#include <stdint.h>
+
+namespace tlc5955
+{
+
+// @brief Maps 8-bit input levels to 16-bit GS PWM values
+using GammaTable = std::array<uint16_t, 256>;
+
+namespace detail
+{
+
+// @brief Natural log for x > 0, usable in constant expressions
+constexpr double constexpr_ln(double x)
+{
+  // reduce to x = m * 2^exponent, m in [0.5, 1)
+  int exponent = 0;
+  while (x >= 1.0)
+  {
+    x /= 2.0;
+    exponent++;
+  }
+  while (x < 0.5)
+  {
+    x *= 2.0;
+    exponent--;
+  }
+  // ln(m) = 2 * atanh((m - 1) / (m + 1))
+  const double y      = (x - 1.0) / (x + 1.0);
+  const double y_sq   = y * y;
+  double term         = y;
+  double atanh_series = 0.0;
+  for (int k = 1; k < 41; k += 2)
+  {
+    atanh_series += term / k;
+    term *= y_sq;
+  }
+  return 2.0 * atanh_series + exponent * 0.693147180559945309;
+}
+
+// @brief e^x, usable in constant expressions
+constexpr double constexpr_exp(double x)
+{
+  // reduce to |x| <= 0.5 then square back up
+  int halvings = 0;
+  while (x > 0.5 || x < -0.5)
+  {
+    x /= 2.0;
+    halvings++;
+  }
+  double term   = 1.0;
+  double series = 1.0;
+  for (int k = 1; k < 20; k++)
+  {
+    term *= x / k;
+    series += term;
+  }
+  for (; halvings > 0; halvings--)
+  {
+    series *= series;
+  }
+  return series;
+}
+
+} // namespace detail
+
+// @brief Build a gamma correction table at compile time: out = 65535 * (in / 255) ^ gamma
+// @param gamma The gamma exponent e.g. 2.2
+constexpr GammaTable make_gamma_table(double gamma)
+{
+  GammaTable table{};
+  for (uint16_t level = 1; level < table.size(); level++)
+  {
+    const double normalised = detail::constexpr_exp(gamma * detail::constexpr_ln(level / 255.0));
+    table[level]            = static_cast<uint16_t>(normalised * 65535.0 + 0.5);
+  }
+  return table;
+}
+
+// @brief Gamma 2.2 correction, placed in flash
+inline constexpr GammaTable gamma_table_2_2{make_gamma_table(2.2)};
+
+// @brief No gamma correction, 8-bit levels scaled to the full 16-bit range
+inline constexpr GammaTable gamma_table_linear{make_gamma_table(1.0)};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_GAMMA_HPP__
@@ -0,0 +1,105 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_GSCLK_HPP__
+#define __TLC5955_GSCLK_HPP__
+
+#include <stdint.h>
+
+namespace tlc5955
+{
+
+// @brief Timer settings for the GSCLK PWM output
+struct GsclkTiming
+{
+  // @brief value for TIMx->PSC
+  uint32_t prescaler{0};
+  // @brief value for TIMx->ARR
+  uint32_t auto_reload{0};
+  // @brief value for TIMx->CCRx (50% duty)
+  uint32_t compare{0};
+  // @brief the achieved GSCLK frequency
+  uint32_t gsclk_hz{0};
+  // @brief the achieved display refresh rate in milliHertz
+  uint32_t refresh_millihz{0};
+};
+
+// @brief Number of GSCLKs in one display period with conventional PWM
+inline constexpr uint32_t gsclk_per_period_normal_pwm{65536};
+// @brief Number of GSCLKs between output updates with ES-PWM (65,536 GSCLKs split into 128 segments)
+inline constexpr uint32_t gsclk_per_period_enhanced_pwm{512};
+// @brief Maximum GSCLK frequency from the TLC5955 datasheet
+inline constexpr uint32_t gsclk_max_hz{33000000};
+
+// @brief Calculate the timer settings for a display refresh rate.
+// Uses the smallest prescaler that fits the 16-bit ARR, for the best frequency resolution, and rounds the
+// divider down so the achieved refresh rate is never lower than the target (unless limited by gsclk_max_hz).
+// @param timer_clock_hz The timer input clock frequency
+// @param target_refresh_hz The required display refresh rate
+// @param gsclk_per_period gsclk_per_period_normal_pwm or gsclk_per_period_enhanced_pwm
+// @return GsclkTiming The timer settings and achieved rates. All zero if the inputs are out of range.
+constexpr GsclkTiming calculate_gsclk_timing(uint32_t timer_clock_hz, uint32_t target_refresh_hz, uint32_t gsclk_per_period)
+{
+  GsclkTiming timing{};
+  if (timer_clock_hz < 2 || target_refresh_hz == 0 || gsclk_per_period == 0)
+  {
+    return timing;
+  }
+
+  uint64_t target_gsclk_hz = static_cast<uint64_t>(target_refresh_hz) * gsclk_per_period;
+  if (target_gsclk_hz > gsclk_max_hz)
+  {
+    target_gsclk_hz = gsclk_max_hz;
+  }
+
+  // total timer clock division, rounded down so the refresh rate is at least the target
+  uint64_t divider = timer_clock_hz / target_gsclk_hz;
+  // but never exceed the TLC5955 maximum GSCLK
+  if (divider == 0 || timer_clock_hz / divider > gsclk_max_hz)
+  {
+    divider = (timer_clock_hz + gsclk_max_hz - 1) / gsclk_max_hz;
+  }
+  // at least 2 so there is a high and a low phase
+  if (divider < 2)
+  {
+    divider = 2;
+  }
+
+  const uint64_t prescaler = (divider - 1) / 65536;
+  if (prescaler > 0xFFFF)
+  {
+    return timing;
+  }
+  const uint64_t period = divider / (prescaler + 1);
+
+  timing.prescaler       = static_cast<uint32_t>(prescaler);
+  timing.auto_reload     = static_cast<uint32_t>(period - 1);
+  timing.compare         = static_cast<uint32_t>(period / 2);
+  timing.gsclk_hz        = static_cast<uint32_t>(timer_clock_hz / ((prescaler + 1) * period));
+  timing.refresh_millihz = static_cast<uint32_t>((static_cast<uint64_t>(timer_clock_hz) * 1000) / ((prescaler + 1) * period * gsclk_per_period));
+  return timing;
+}
+
+} // namespace tlc5955
+
+#endif // __TLC5955_GSCLK_HPP__
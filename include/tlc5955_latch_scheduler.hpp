@@ -0,0 +1,107 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_LATCH_SCHEDULER_HPP__
+#define __TLC5955_LATCH_SCHEDULER_HPP__
+
+#include <tlc5955.hpp>
+
+namespace tlc5955
+{
+
+// @brief Frame timing reported by the LatchScheduler
+struct LatchSchedulerStats
+{
+  // @brief number of frames latched on a display period boundary
+  uint32_t frames_latched{0};
+  // @brief number of queued frames that were replaced by a newer frame before they could be latched
+  uint32_t frames_dropped{0};
+  // @brief number of display periods that ended with no frame queued
+  uint32_t idle_periods{0};
+  // @brief GSCLKs remaining in the display period when the last frame was queued
+  uint32_t last_slack{0};
+  // @brief smallest slack seen since the last reset. A value near zero means the frame rate is at its limit.
+  uint32_t min_slack{UINT32_MAX};
+};
+
+// @brief Latch GS data on display period boundaries ("vsync") to avoid mid-PWM-cycle updates.
+//
+// The period timer must count GSCLK pulses, e.g. a timer in external clock/slave mode triggered from
+// the GSCLK timer TRGO (the trigger routing is specific to the timer pair so is left to the application).
+// Its update event then fires every 65,536 GSCLKs, at the end of each TLC5955 display period.
+//
+// Usage:
+// 1) call start() once after Driver::init()
+// 2) when ready() shift the next frame with LatchPinOption::no_latch, then call queue_latch()
+// 3) call isr() from the period timer update interrupt handler
+class LatchScheduler
+{
+public:
+  // @brief Construct a new Latch Scheduler object
+  // @param driver The driver whose LAT pin is pulsed at each display period boundary
+  // @param period_tim The TIM peripheral counting GSCLK pulses e.g. TIM3
+  LatchScheduler(Driver &driver, TIM_TypeDef *period_tim);
+
+  // @brief Number of GSCLKs in one TLC5955 display period
+  static constexpr uint32_t m_display_period_gsclk{65536};
+
+  // @brief Set the period timer to the display period, enable its update interrupt and start it.
+  // The first display period is aligned by the first latch when timing_reset_on is used.
+  void start();
+
+  // @brief Stop the period timer and discard any queued latch
+  void stop();
+
+  // @brief Check if the common shift register can accept the next frame.
+  // Shifting a new frame while a latch is pending overwrites the pending frame.
+  // @return true if no latch is pending
+  bool ready() const { return !m_latch_pending; }
+
+  // @brief Request a latch at the next display period boundary.
+  // Call after the frame has been shifted into the chain with LatchPinOption::no_latch.
+  // @return false if a pending frame was replaced (counted in frames_dropped)
+  bool queue_latch();
+
+  // @brief Period timer update interrupt handler. Latches the queued frame, if any.
+  void isr();
+
+  // @brief Get a snapshot of the frame timing
+  LatchSchedulerStats get_stats() const { return m_stats; }
+
+  // @brief Reset the frame timing
+  void reset_stats() { m_stats = LatchSchedulerStats{}; }
+
+private:
+  // @brief The driver used to pulse LAT
+  Driver &m_driver;
+  // @brief Timer counting GSCLKs
+  TIM_TypeDef &m_period_tim;
+  // @brief Set by queue_latch(), cleared by isr()
+  volatile bool m_latch_pending{false};
+  // @brief frame timing
+  LatchSchedulerStats m_stats{};
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_LATCH_SCHEDULER_HPP__
@@ -0,0 +1,188 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_MULTI_BUS_HPP__
+#define __TLC5955_MULTI_BUS_HPP__
+
+#include <tlc5955.hpp>
+#include <tlc5955_spi_dma.hpp>
+#include <utility>
+
+namespace tlc5955
+{
+
+// @brief Splits one logical LED array across several SPI peripherals, each driving its own daisy chain.
+// Each bus has its own DMA channel: the first bit is clocked on each bus in turn and its DMA transfer started
+// straight away, so all the chains shift at the same time and frame time scales down with NUM_BUSES.
+// Logical chip c is chip (c % CHIPS_PER_BUS) of bus (c / CHIPS_PER_BUS).
+//
+// Each bus needs its own Driver, constructed and init()'d by the application as usual, and its own DMA channel
+// routed to that SPI TX request (DMAMUX on STM32G0).
+// @tparam NUM_BUSES The number of SPI peripherals
+// @tparam CHIPS_PER_BUS The number of daisy-chained chips on each bus
+template <size_t NUM_BUSES, size_t CHIPS_PER_BUS> class MultiBusDriver
+{
+public:
+  static_assert(NUM_BUSES > 0, "MultiBusDriver needs at least one bus");
+
+  // @brief The logical LED array
+  using frame_t = GreyscaleFrame<NUM_BUSES * CHIPS_PER_BUS>;
+
+  // @brief How the chains are latched
+  enum class LatchMode
+  {
+    // @brief All chains share one LAT line, driven by the first bus
+    shared,
+    // @brief Each chain has its own LAT line. Lines on the same GPIO port are pulsed by one register write;
+    // each extra port adds a few cycles of skew.
+    per_bus
+  };
+
+  // @brief Construct a new Multi Bus Driver object
+  // @param buses The Driver for each SPI peripheral, in logical chip order
+  // @param tx_dmas The DMA channel routed to each bus's SPI TX request, in the same order
+  // @param latch_mode Shared or per-bus LAT line
+  MultiBusDriver(const std::array<Driver *, NUM_BUSES> &buses,
+                 const std::array<DMA_Channel_TypeDef *, NUM_BUSES> &tx_dmas,
+                 LatchMode latch_mode = LatchMode::per_bus)
+      : m_buses(buses),
+        m_tx_dmas(make_tx_dmas(buses, tx_dmas, std::make_index_sequence<NUM_BUSES>{})),
+        m_latch_mode(latch_mode)
+  {
+    // group the LAT pins by port, so latch() needs one set and one reset write per port
+    for (Driver *bus : m_buses)
+    {
+      GPIO_TypeDef *lat_port = &bus->m_serial_interface.get_lat_port();
+      size_t port_idx        = 0;
+      while (port_idx < m_num_lat_ports && m_lat_ports[port_idx] != lat_port)
+      {
+        port_idx++;
+      }
+      if (port_idx == m_num_lat_ports)
+      {
+        m_lat_ports[m_num_lat_ports++] = lat_port;
+      }
+      m_lat_pins[port_idx] = m_lat_pins[port_idx] | bus->m_serial_interface.get_lat_pin();
+    }
+  }
+
+  // @brief Get the logical LED array
+  frame_t &frame() { return m_frame; }
+
+  // @brief Set the greyscale RGB bits at a logical LED position
+  // @param led_idx Must be value: 0 to (NUM_BUSES * CHIPS_PER_BUS * 16)-1
+  // @param red_pwm Must be value: 0-2^16
+  // @param green_pwm Must be value: 0-2^16
+  // @param blue_pwm Must be value: 0-2^16
+  // @return false if led_idx is out of range
+  bool set_greyscale_cmd_rgb_at_position(size_t led_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    return m_frame.set_rgb(led_idx, red_pwm, green_pwm, blue_pwm);
+  }
+
+  // @brief Shift the logical LED array into all chains concurrently and options with/without latch
+  // @param latch_option latch all chains after send or no latch after send
+  void send_frame(Driver::LatchPinOption latch_option)
+  {
+    for (size_t chip_idx = 0; chip_idx < CHIPS_PER_BUS; chip_idx++)
+    {
+      send_chip_all_buses(chip_idx);
+    }
+
+    if (latch_option == Driver::LatchPinOption::latch_after_send)
+    {
+      latch();
+    }
+  }
+
+  // @brief Pulse LAT on every chain
+  void latch()
+  {
+    if (m_latch_mode == LatchMode::shared)
+    {
+      m_buses[0]->latch();
+      return;
+    }
+#if not defined(X86_UNIT_TESTING_ONLY)
+    for (size_t port_idx = 0; port_idx < m_num_lat_ports; port_idx++)
+    {
+      LL_GPIO_SetOutputPin(m_lat_ports[port_idx], m_lat_pins[port_idx]);
+    }
+    for (size_t port_idx = 0; port_idx < m_num_lat_ports; port_idx++)
+    {
+      LL_GPIO_ResetOutputPin(m_lat_ports[port_idx], m_lat_pins[port_idx]);
+    }
+#endif
+    for (Driver *bus : m_buses)
+    {
+      bus->m_stats.add_latch();
+    }
+  }
+
+  // @brief Get the number of GPIO ports the per-bus LAT lines are spread over, i.e. the writes per latch() edge
+  size_t get_num_lat_ports() const { return m_num_lat_ports; }
+
+private:
+  // @brief The Driver for each SPI peripheral
+  std::array<Driver *, NUM_BUSES> m_buses;
+  // @brief The DMA channel for each SPI peripheral
+  std::array<SpiTxDma, NUM_BUSES> m_tx_dmas;
+  // @brief Shared or per-bus LAT line
+  LatchMode m_latch_mode;
+  // @brief The distinct LAT ports
+  std::array<GPIO_TypeDef *, NUM_BUSES> m_lat_ports{};
+  // @brief The LAT pins on each of m_lat_ports
+  std::array<uint32_t, NUM_BUSES> m_lat_pins{};
+  // @brief The number of m_lat_ports in use
+  size_t m_num_lat_ports{0};
+  // @brief The logical LED array
+  frame_t m_frame{};
+
+  // @brief Pair each bus with its DMA channel
+  template <size_t... BUS_IDX>
+  static std::array<SpiTxDma, NUM_BUSES> make_tx_dmas(const std::array<Driver *, NUM_BUSES> &buses,
+                                                      const std::array<DMA_Channel_TypeDef *, NUM_BUSES> &tx_dmas,
+                                                      std::index_sequence<BUS_IDX...>)
+  {
+    return {SpiTxDma(*buses[BUS_IDX], tx_dmas[BUS_IDX])...};
+  }
+
+  // @brief Send chip chip_idx of every bus
+  void send_chip_all_buses(size_t chip_idx)
+  {
+    // each transfer runs while the next bus clocks its first bit
+    for (size_t bus_idx = 0; bus_idx < NUM_BUSES; bus_idx++)
+    {
+      m_buses[bus_idx]->shift_first_bit(Driver::DataLatchType::data);
+      m_tx_dmas[bus_idx].start(std::as_const(m_frame).chip(bus_idx * CHIPS_PER_BUS + chip_idx));
+    }
+    for (SpiTxDma &tx_dma : m_tx_dmas)
+    {
+      tx_dma.wait();
+    }
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_MULTI_BUS_HPP__
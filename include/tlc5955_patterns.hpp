@@ -0,0 +1,327 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_PATTERNS_HPP__
+#define __TLC5955_PATTERNS_HPP__
+
+#include <algorithm>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief A 16-bit colour
+struct RgbColour
+{
+  uint16_t red{0};
+  uint16_t green{0};
+  uint16_t blue{0};
+};
+
+// @brief One cycle of a sine wave, offset and scaled to 0-65535
+using SineTable = std::array<uint16_t, 256>;
+// @brief A fully saturated hue wheel: red, green, blue and back to red
+using HueTable = std::array<RgbColour, 256>;
+
+namespace detail
+{
+
+// @brief sin(x), usable in constant expressions
+constexpr double constexpr_sin(double x)
+{
+  constexpr double pi = 3.14159265358979323846;
+  while (x > pi)
+  {
+    x -= 2.0 * pi;
+  }
+  while (x < -pi)
+  {
+    x += 2.0 * pi;
+  }
+  double term   = x;
+  double series = x;
+  for (int k = 1; k < 15; k++)
+  {
+    term *= -x * x / ((2 * k) * (2 * k + 1));
+    series += term;
+  }
+  return series;
+}
+
+constexpr SineTable make_sine_table()
+{
+  SineTable table{};
+  for (size_t idx = 0; idx < table.size(); idx++)
+  {
+    const double sine = detail::constexpr_sin(2.0 * 3.14159265358979323846 * static_cast<double>(idx) / 256.0);
+    table[idx]        = static_cast<uint16_t>(32767.5 + 32767.5 * sine + 0.5);
+  }
+  return table;
+}
+
+constexpr HueTable make_hue_table()
+{
+  HueTable table{};
+  for (size_t idx = 0; idx < table.size(); idx++)
+  {
+    const double position = static_cast<double>(idx) * 3.0 / 256.0;
+    const size_t sector   = static_cast<size_t>(position);
+    const auto rising     = static_cast<uint16_t>((position - static_cast<double>(sector)) * 65535.0 + 0.5);
+    const auto falling    = static_cast<uint16_t>(65535 - rising);
+    switch (sector)
+    {
+      case 0:
+        table[idx] = RgbColour{falling, rising, 0};
+        break;
+      case 1:
+        table[idx] = RgbColour{0, falling, rising};
+        break;
+      default:
+        table[idx] = RgbColour{rising, 0, falling};
+        break;
+    }
+  }
+  return table;
+}
+
+} // namespace detail
+
+// @brief Sine table in flash, indexed by the top 8 bits of a phase
+inline constexpr SineTable sine_table{detail::make_sine_table()};
+// @brief Hue wheel in flash, indexed by the top 8 bits of a hue
+inline constexpr HueTable hue_table{detail::make_hue_table()};
+
+// @brief Get the per-frame phase increment for a pattern period. A full cycle is 2^32.
+// @param period_ms The time for one cycle
+// @param frame_hz The number of render() calls per second
+constexpr uint32_t phase_step(uint32_t period_ms, uint32_t frame_hz)
+{
+  const uint64_t frames_per_period = (static_cast<uint64_t>(period_ms) * frame_hz) / 1000;
+  return (frames_per_period == 0) ? 0 : static_cast<uint32_t>((uint64_t{1} << 32) / frames_per_period);
+}
+
+// @brief Scale a colour
+// @param colour The colour at full level
+// @param level 0 to 65535, where 65535 leaves the colour unchanged
+constexpr RgbColour scale_colour(const RgbColour &colour, uint16_t level)
+{
+  const uint32_t factor = static_cast<uint32_t>(level) + 1;
+  return RgbColour{static_cast<uint16_t>((colour.red * factor) >> 16), static_cast<uint16_t>((colour.green * factor) >> 16),
+                   static_cast<uint16_t>((colour.blue * factor) >> 16)};
+}
+
+// Each pattern renders a whole chain frame per call in constant time per LED and advances by one frame.
+// Speeds are phase increments per frame (see phase_step()).
+
+// @brief Lit blocks moving along the chain
+class ChasePattern
+{
+public:
+  // @param colour The lit colour
+  // @param spacing The distance between the starts of two lit blocks, in LEDs
+  // @param width The number of lit LEDs per block
+  // @param frames_per_step The number of frames before the blocks move one LED
+  ChasePattern(RgbColour colour, uint16_t spacing, uint16_t width, uint16_t frames_per_step)
+      : m_colour(colour),
+        m_spacing(spacing == 0 ? 1 : spacing),
+        m_width(width),
+        m_frames_per_step(frames_per_step == 0 ? 1 : frames_per_step)
+  {
+  }
+
+  template <size_t NUM_CHIPS> void render(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    // a wrapping counter rather than a modulo per LED
+    uint16_t position = m_offset;
+    for (size_t led_idx = 0; led_idx < GreyscaleFrame<NUM_CHIPS>::m_num_leds; led_idx++)
+    {
+      const RgbColour colour = (position < m_width) ? m_colour : RgbColour{};
+      frame.set_rgb(led_idx, colour.red, colour.green, colour.blue);
+      position = static_cast<uint16_t>((position + 1 == m_spacing) ? 0 : position + 1);
+    }
+
+    if (++m_frame_count >= m_frames_per_step)
+    {
+      m_frame_count = 0;
+      m_offset      = static_cast<uint16_t>((m_offset == 0) ? m_spacing - 1 : m_offset - 1);
+    }
+  }
+
+private:
+  RgbColour m_colour;
+  uint16_t m_spacing;
+  uint16_t m_width;
+  uint16_t m_frames_per_step;
+  uint16_t m_frame_count{0};
+  // @brief the block position of LED 0
+  uint16_t m_offset{0};
+};
+
+// @brief A hue wheel spread along the chain and rotating
+class RainbowPattern
+{
+public:
+  // @param speed The hue rotation per frame
+  // @param spread The hue change from one LED to the next. 2^32 / num LEDs shows one whole wheel.
+  // @param level Q16 brightness
+  RainbowPattern(uint32_t speed, uint32_t spread, uint16_t level = 0xFFFF)
+      : m_speed(speed),
+        m_spread(spread),
+        m_level(level)
+  {
+  }
+
+  template <size_t NUM_CHIPS> void render(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    uint32_t hue = m_phase;
+    for (size_t led_idx = 0; led_idx < GreyscaleFrame<NUM_CHIPS>::m_num_leds; led_idx++)
+    {
+      const RgbColour colour = scale_colour(hue_table[hue >> 24], m_level);
+      frame.set_rgb(led_idx, colour.red, colour.green, colour.blue);
+      hue += m_spread;
+    }
+    m_phase += m_speed;
+  }
+
+private:
+  uint32_t m_speed;
+  uint32_t m_spread;
+  uint16_t m_level;
+  uint32_t m_phase{0};
+};
+
+// @brief The whole chain fading in and out on a sine wave
+class BreathePattern
+{
+public:
+  // @param colour The colour at the peak
+  // @param speed The phase increment per frame
+  BreathePattern(RgbColour colour, uint32_t speed)
+      : m_colour(colour),
+        m_speed(speed)
+  {
+  }
+
+  template <size_t NUM_CHIPS> void render(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    // start dark: index 192 is the minimum of the sine table
+    const RgbColour colour = scale_colour(m_colour, sine_table[((m_phase >> 24) + 192) & 0xFF]);
+    frame.fill_rgb(colour.red, colour.green, colour.blue);
+    m_phase += m_speed;
+  }
+
+private:
+  RgbColour m_colour;
+  uint32_t m_speed;
+  uint32_t m_phase{0};
+};
+
+// @brief LEDs lighting at random and fading out
+// @tparam NUM_CHIPS The number of daisy-chained chips, for the per-LED levels
+template <size_t NUM_CHIPS> class TwinklePattern
+{
+public:
+  // @param colour The colour of a new twinkle
+  // @param density The chance of an LED starting a twinkle each frame, out of 65536
+  // @param decay_shift Each frame the level drops by level >> decay_shift. Clamped to 1-15.
+  // @param seed The random seed. Must be non-zero.
+  TwinklePattern(RgbColour colour, uint16_t density, uint8_t decay_shift, uint32_t seed = 0x12345678)
+      : m_colour(colour),
+        m_density(density),
+        m_decay_shift(std::clamp<uint8_t>(decay_shift, 1, 15)),
+        m_random(seed == 0 ? 1 : seed)
+  {
+  }
+
+  void render(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    for (size_t led_idx = 0; led_idx < GreyscaleFrame<NUM_CHIPS>::m_num_leds; led_idx++)
+    {
+      // xorshift32
+      m_random ^= m_random << 13;
+      m_random ^= m_random >> 17;
+      m_random ^= m_random << 5;
+
+      uint16_t level = static_cast<uint16_t>(m_levels[led_idx] - (m_levels[led_idx] >> m_decay_shift));
+      if ((m_random & 0xFFFF) < m_density)
+      {
+        level = 0xFFFF;
+      }
+      m_levels[led_idx]      = level;
+      const RgbColour colour = scale_colour(m_colour, level);
+      frame.set_rgb(led_idx, colour.red, colour.green, colour.blue);
+    }
+  }
+
+private:
+  RgbColour m_colour;
+  uint16_t m_density;
+  uint8_t m_decay_shift;
+  uint32_t m_random;
+  // @brief The level of each LED
+  std::array<uint16_t, GreyscaleFrame<NUM_CHIPS>::m_num_leds> m_levels{};
+};
+
+// @brief A bright head with a fading tail, wrapping round the chain
+class CometPattern
+{
+public:
+  // @param colour The head colour
+  // @param tail_length The number of LEDs in the tail
+  // @param speed The head movement per frame in LEDs, Q16
+  CometPattern(RgbColour colour, uint16_t tail_length, uint32_t speed)
+      : m_colour(colour),
+        m_tail_length(tail_length == 0 ? 1 : tail_length),
+        m_speed(speed)
+  {
+  }
+
+  template <size_t NUM_CHIPS> void render(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    constexpr size_t num_leds = GreyscaleFrame<NUM_CHIPS>::m_num_leds;
+    const size_t head         = (m_position >> 16) % num_leds;
+    const uint32_t fade_step  = 0xFFFF / m_tail_length;
+
+    // walk backwards from the head so the distance is a counter, not a modulo
+    size_t led_idx = head;
+    for (size_t distance = 0; distance < num_leds; distance++)
+    {
+      const uint16_t level   = (distance < m_tail_length) ? static_cast<uint16_t>(0xFFFF - distance * fade_step) : 0;
+      const RgbColour colour = scale_colour(m_colour, level);
+      frame.set_rgb(led_idx, colour.red, colour.green, colour.blue);
+      led_idx = (led_idx == 0) ? num_leds - 1 : led_idx - 1;
+    }
+    m_position = static_cast<uint32_t>((m_position + m_speed) % (static_cast<uint64_t>(num_leds) << 16));
+  }
+
+private:
+  RgbColour m_colour;
+  uint16_t m_tail_length;
+  uint32_t m_speed;
+  // @brief The head position in LEDs, Q16
+  uint32_t m_position{0};
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_PATTERNS_HPP__
@@ -0,0 +1,121 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_PIPELINE_HPP__
+#define __TLC5955_PIPELINE_HPP__
+
+#include <tlc5955.hpp>
+#include <tlc5955_spi_dma.hpp>
+
+namespace tlc5955
+{
+
+// @brief Sends a daisy chain while packing it: DMA shifts out chip k from one staging buffer
+// while the CPU packs chip k+1 into the other, so each chip costs max(pack, transmit) rather than the sum.
+// Only two chip-sized (96 byte) staging buffers are used, whatever the chain length.
+//
+// The application must route the SPI TX DMA request to the DMA channel (DMAMUX on STM32G0).
+class PipelinedSender
+{
+public:
+  // @brief Construct a new Pipelined Sender object
+  // @param driver The driver for the chain
+  // @param tx_dma The DMA channel routed to the SPI TX request e.g. DMA1_Channel1
+  PipelinedSender(Driver &driver, DMA_Channel_TypeDef *tx_dma);
+
+  // @brief Pack and send a chain of chips, and options with/without latch
+  // @tparam PACK_FN callable with signature void(size_t chip_idx, std::span<uint8_t, chip_frame_size_bytes> out)
+  // @param num_chips The number of chips in the chain
+  // @param pack_chip Called once per chip, in shift order, to write that chip's 96 bytes
+  // @param latch_type control message or data message
+  // @param latch_option latch after send or no latch after send
+  template <typename PACK_FN>
+  void send(size_t num_chips, PACK_FN pack_chip, Driver::DataLatchType latch_type, Driver::LatchPinOption latch_option)
+  {
+    if (num_chips == 0)
+    {
+      return;
+    }
+
+    pack(pack_chip, 0);
+    for (size_t chip_idx = 0; chip_idx < num_chips; chip_idx++)
+    {
+      // the previous chip must be fully shifted out before the pins are used to clock the first bit
+      m_tx_dma.wait();
+      m_driver.shift_first_bit(latch_type);
+      m_tx_dma.start(m_staging[chip_idx % 2]);
+
+      if (chip_idx + 1 < num_chips)
+      {
+        pack(pack_chip, chip_idx + 1);
+      }
+    }
+    m_tx_dma.wait();
+
+    if (latch_option == Driver::LatchPinOption::latch_after_send)
+    {
+      m_driver.latch();
+    }
+  }
+
+  // @brief Pack and send a GreyscaleFrame, and options with/without latch
+  // @param frame The chain GS data
+  // @param latch_option latch after send or no latch after send
+  template <size_t NUM_CHIPS> void send(const GreyscaleFrame<NUM_CHIPS> &frame, Driver::LatchPinOption latch_option)
+  {
+    send(
+        NUM_CHIPS,
+        [&frame](size_t chip_idx, std::span<uint8_t, chip_frame_size_bytes> out) {
+          const auto chip_bytes = frame.chip(chip_idx);
+          std::copy(chip_bytes.begin(), chip_bytes.end(), out.begin());
+        },
+        Driver::DataLatchType::data,
+        latch_option);
+  }
+
+  // @brief Send the driver's frame store (see Driver::set_frame_store()) straight from memory, without staging copies
+  // @param latch_type control message or data message
+  // @param latch_option latch after send or no latch after send
+  // @return false if no frame store is set
+  bool send_frame_store(Driver::DataLatchType latch_type, Driver::LatchPinOption latch_option);
+
+private:
+  // @brief The driver for the chain
+  Driver &m_driver;
+  // @brief The DMA channel feeding the SPI TX FIFO
+  SpiTxDma m_tx_dma;
+  // @brief ping-pong staging buffers
+  alignas(4) std::array<std::array<uint8_t, chip_frame_size_bytes>, 2> m_staging{};
+
+  // @brief Pack chip_idx into its staging buffer
+  template <typename PACK_FN> void pack(PACK_FN &pack_chip, size_t chip_idx)
+  {
+    [[maybe_unused]] const uint32_t packing_start = m_driver.m_stats.start();
+    pack_chip(chip_idx, std::span<uint8_t, chip_frame_size_bytes>(m_staging[chip_idx % 2]));
+    m_driver.m_stats.add_packing_ticks(packing_start);
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_PIPELINE_HPP__
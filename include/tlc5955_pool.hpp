@@ -0,0 +1,155 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_POOL_HPP__
+#define __TLC5955_POOL_HPP__
+
+#include <bitset>
+#include <new>
+#include <tlc5955_frame.hpp>
+#include <utility>
+// disable dynamic allocation/copying
+#include <restricted_base.hpp>
+
+namespace tlc5955
+{
+
+// @brief A fixed-capacity pool of T, sized at compile time, for frames, keyframes and layer buffers
+// without the heap. Every block is the same size, so allocate() and release() are O(1) free-list operations
+// and the pool never fragments. Objects are constructed in place by allocate() and destroyed by release().
+// @tparam T The object type. May itself be a RestrictedBase.
+// @tparam CAPACITY The number of objects the pool can hold
+template <typename T, size_t CAPACITY> class StaticPool : public RestrictedBase
+{
+public:
+  static_assert(CAPACITY > 0 && CAPACITY < 0xFFFF, "StaticPool capacity must be 1-65534");
+
+  StaticPool()
+  {
+    for (size_t idx = 0; idx < CAPACITY; idx++)
+    {
+      m_next_free[idx] = static_cast<uint16_t>(idx + 1);
+    }
+  }
+
+  ~StaticPool()
+  {
+    for (size_t idx = 0; idx < CAPACITY; idx++)
+    {
+      if (m_in_use[idx])
+      {
+        slot(idx)->~T();
+      }
+    }
+  }
+
+  // @brief Construct an object in a free block
+  // @param args The constructor arguments
+  // @return T* The object, or nullptr if the pool is full
+  template <typename... ARGS> T *allocate(ARGS &&...args)
+  {
+    if (m_free_head == m_end_of_list)
+    {
+      return nullptr;
+    }
+    const size_t idx = m_free_head;
+    m_free_head      = m_next_free[idx];
+    m_in_use[idx]    = true;
+    m_num_allocated++;
+    return ::new (static_cast<void *>(&m_storage[idx * sizeof(T)])) T(std::forward<ARGS>(args)...);
+  }
+
+  // @brief Destroy an object and return its block to the pool
+  // @param object An object from allocate()
+  // @return false if the object is not from this pool or was already released
+  bool release(T *object)
+  {
+    size_t idx = 0;
+    if (!index_of(object, idx) || !m_in_use[idx])
+    {
+      return false;
+    }
+    object->~T();
+    m_in_use[idx]    = false;
+    m_next_free[idx] = m_free_head;
+    m_free_head      = static_cast<uint16_t>(idx);
+    m_num_allocated--;
+    return true;
+  }
+
+  // @brief Get the index of an object's block, e.g. to store a compact handle
+  // @param object An object from allocate()
+  // @param idx Set to the block index: 0 to CAPACITY-1
+  // @return false if the object is not from this pool
+  bool index_of(const T *object, size_t &idx) const
+  {
+    const uintptr_t first  = reinterpret_cast<uintptr_t>(m_storage);
+    const uintptr_t target = reinterpret_cast<uintptr_t>(object);
+    if (target < first || !(target < first + sizeof(m_storage)) || ((target - first) % sizeof(T)) != 0)
+    {
+      return false;
+    }
+    idx = (target - first) / sizeof(T);
+    return true;
+  }
+
+  // @brief Get an allocated object by its block index
+  // @return T* The object, or nullptr if the block is free or out of range
+  T *at(size_t idx) { return (idx < CAPACITY && m_in_use[idx]) ? slot(idx) : nullptr; }
+
+  // @brief The number of allocated objects
+  size_t size() const { return m_num_allocated; }
+
+  // @brief The number of free blocks
+  size_t available() const { return CAPACITY - m_num_allocated; }
+
+  // @brief The number of blocks
+  static constexpr size_t capacity() { return CAPACITY; }
+
+private:
+  // @brief marks the end of the free list
+  static constexpr uint16_t m_end_of_list{CAPACITY};
+
+  // @brief The blocks
+  alignas(T) uint8_t m_storage[sizeof(T) * CAPACITY];
+  // @brief The next free block after each free block
+  std::array<uint16_t, CAPACITY> m_next_free{};
+  // @brief The allocated blocks
+  std::bitset<CAPACITY> m_in_use{0};
+  // @brief The first free block
+  uint16_t m_free_head{0};
+  // @brief The number of allocated objects
+  size_t m_num_allocated{0};
+
+  // @brief Get the object in a block
+  T *slot(size_t idx) { return std::launder(reinterpret_cast<T *>(&m_storage[idx * sizeof(T)])); }
+};
+
+// @brief A pool of GreyscaleFrame, e.g. for the frames of an animation sequence
+// @tparam NUM_CHIPS The number of daisy-chained chips per frame
+// @tparam CAPACITY The number of frames
+template <size_t NUM_CHIPS, size_t CAPACITY> using FramePool = StaticPool<GreyscaleFrame<NUM_CHIPS>, CAPACITY>;
+
+} // namespace tlc5955
+
+#endif // __TLC5955_POOL_HPP__
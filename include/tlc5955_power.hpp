@@ -0,0 +1,216 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_POWER_HPP__
+#define __TLC5955_POWER_HPP__
+
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief Full-scale output current in microamps for each max current (MC) setting 0-7
+inline constexpr std::array<uint32_t, 8> max_current_ua{3200, 8000, 11200, 15900, 19100, 23900, 27100, 31900};
+
+// @brief Get the average current of one output at full-scale GS
+// BC scales from 10% (0) to 100% (127), DC scales from 26.2% (0) to 100% (127).
+// @param max_current MC: 0-7
+// @param global_brightness BC: 0-127
+// @param dot_correction DC: 0-127
+// @return uint32_t The current in nanoamps
+constexpr uint32_t output_full_scale_na(uint8_t max_current, uint8_t global_brightness, uint8_t dot_correction)
+{
+  // 1270 * (0.1 + 0.9 * BC / 127) and 127000 * (0.262 + 0.738 * DC / 127)
+  const uint64_t bc_factor = 1270 + 90 * static_cast<uint64_t>(global_brightness & 0x7F);
+  const uint64_t dc_factor = 33274 + 738 * static_cast<uint64_t>(dot_correction & 0x7F);
+  return static_cast<uint32_t>((max_current_ua[max_current & 0x7] * bc_factor * dc_factor) / 1612900);
+}
+
+// @brief Estimates the supply current of a chain from its GS data and control settings (BC, MC, DC),
+// and limits it to a budget by lowering BC so the GS data does not have to be rewritten.
+//
+// The GS sum per colour is kept up to date as channels are written through the limiter, so an estimate never
+// rescans the frame. Call recalculate() after writing the frame some other way (e.g. DmxDecoder, Compositor).
+// BC cannot go below 10% of full scale; for tighter budgets get_greyscale_scale() gives the remaining
+// factor to apply to the GS data, e.g. with ColourCorrector::set_brightness().
+// The control settings are per colour for the whole chain, as sent by Driver::init().
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class PowerLimiter
+{
+public:
+  static_assert(GreyscaleFrame<NUM_CHIPS>::m_num_leds <= 65536, "GS sums are 32-bit");
+
+  // @brief Construct a new Power Limiter object
+  // @param frame The GS data for the chain
+  // @param budget_ua The supply current budget for the chain's outputs in microamps
+  PowerLimiter(GreyscaleFrame<NUM_CHIPS> &frame, uint32_t budget_ua)
+      : m_frame(frame),
+        m_budget_ua(budget_ua)
+  {
+    recalculate();
+  }
+
+  // @brief Set the control settings the application would use without a budget.
+  // Arrays are in the same blue, green, red order as Driver::init().
+  // @param global_brightness BC: 0-127
+  // @param max_current MC: 0-7
+  // @param dot_correction DC for all channels: 0-127
+  void set_control(std::array<uint8_t, 3> global_brightness, std::array<uint8_t, 3> max_current, uint8_t dot_correction)
+  {
+    m_nominal_brightness = global_brightness;
+    m_max_current        = max_current;
+    m_dot_correction     = dot_correction;
+  }
+
+  // @brief Set the supply current budget
+  // @param budget_ua The budget in microamps
+  void set_budget(uint32_t budget_ua) { m_budget_ua = budget_ua; }
+
+  // @brief Set one 16-bit GS channel and update the estimate
+  // @return false if either index is out of range
+  bool set_channel(size_t chip_idx, size_t channel_idx, uint16_t pwm)
+  {
+    const uint16_t previous = m_frame.get_channel(chip_idx, channel_idx);
+    if (!m_frame.set_channel(chip_idx, channel_idx, pwm))
+    {
+      return false;
+    }
+    update_sum(channel_idx % colour_channels_per_led, previous, pwm);
+    return true;
+  }
+
+  // @brief Set the RGB channels of an LED and update the estimate
+  // @return false if led_idx is out of range
+  bool set_rgb(size_t led_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    const uint16_t previous_red   = m_frame.get_colour(led_idx, ColourChannel::red);
+    const uint16_t previous_green = m_frame.get_colour(led_idx, ColourChannel::green);
+    const uint16_t previous_blue  = m_frame.get_colour(led_idx, ColourChannel::blue);
+    if (!m_frame.set_rgb(led_idx, red_pwm, green_pwm, blue_pwm))
+    {
+      return false;
+    }
+    update_sum(static_cast<size_t>(ColourChannel::red), previous_red, red_pwm);
+    update_sum(static_cast<size_t>(ColourChannel::green), previous_green, green_pwm);
+    update_sum(static_cast<size_t>(ColourChannel::blue), previous_blue, blue_pwm);
+    return true;
+  }
+
+  // @brief Rescan the frame after it was written without the limiter
+  void recalculate()
+  {
+    m_gs_sum.fill(0);
+    for (size_t led_idx = 0; led_idx < GreyscaleFrame<NUM_CHIPS>::m_num_leds; led_idx++)
+    {
+      for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+      {
+        m_gs_sum[colour_idx] += m_frame.get_colour(led_idx, static_cast<ColourChannel>(colour_idx));
+      }
+    }
+  }
+
+  // @brief Estimate the current with the nominal BC
+  // @return uint32_t microamps
+  uint32_t estimate_ua() const { return estimate_ua(m_nominal_brightness); }
+
+  // @brief Estimate the current with the limited BC and GS scale
+  // @return uint32_t microamps
+  uint32_t limited_estimate_ua() const
+  {
+    return static_cast<uint32_t>((static_cast<uint64_t>(estimate_ua(m_limited_brightness)) * m_greyscale_scale) >> 8);
+  }
+
+  // @brief Recompute the limited BC for the current frame. Call once per frame before sending it.
+  // @return true if the limited BC changed, so the control data must be resent, e.g. with Driver::init()
+  bool update()
+  {
+    const std::array<uint8_t, 3> previous = m_limited_brightness;
+    m_limited_brightness                  = m_nominal_brightness;
+    m_greyscale_scale                     = 256;
+
+    const uint32_t nominal_ua = estimate_ua();
+    if (nominal_ua > m_budget_ua)
+    {
+      for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+      {
+        // scale the BC factor (1270 at BC 0, 12700 at BC 127) by budget / estimate, rounding down
+        const uint64_t nominal_factor = 1270 + 90 * static_cast<uint64_t>(m_nominal_brightness[colour_idx] & 0x7F);
+        const uint64_t target_factor  = (nominal_factor * m_budget_ua) / nominal_ua;
+        m_limited_brightness[colour_idx] =
+            (target_factor > 1270) ? static_cast<uint8_t>((target_factor - 1270) / 90) : static_cast<uint8_t>(0);
+      }
+      const uint32_t limited_ua = estimate_ua(m_limited_brightness);
+      if (limited_ua > m_budget_ua)
+      {
+        m_greyscale_scale = static_cast<uint16_t>((static_cast<uint64_t>(m_budget_ua) << 8) / limited_ua);
+      }
+    }
+    return m_limited_brightness != previous;
+  }
+
+  // @brief Get the BC to send, in blue, green, red order for Driver::init()
+  std::array<uint8_t, 3> get_global_brightness() const { return m_limited_brightness; }
+
+  // @brief Get the GS scale still needed once BC is at its minimum
+  // @return uint16_t Q8: 256 means no scaling is needed
+  uint16_t get_greyscale_scale() const { return m_greyscale_scale; }
+
+private:
+  // @brief The GS data for the chain
+  GreyscaleFrame<NUM_CHIPS> &m_frame;
+  // @brief The supply current budget in microamps
+  uint32_t m_budget_ua;
+  // @brief Sum of GS values per colour, indexed by ColourChannel
+  std::array<uint32_t, colour_channels_per_led> m_gs_sum{};
+  // @brief BC without a budget: blue, green, red
+  std::array<uint8_t, 3> m_nominal_brightness{{0x7F, 0x7F, 0x7F}};
+  // @brief BC within the budget: blue, green, red
+  std::array<uint8_t, 3> m_limited_brightness{{0x7F, 0x7F, 0x7F}};
+  // @brief MC: blue, green, red
+  std::array<uint8_t, 3> m_max_current{{0x1, 0x1, 0x1}};
+  // @brief DC for all channels
+  uint8_t m_dot_correction{0x7F};
+  // @brief Q8 GS scale still needed at minimum BC
+  uint16_t m_greyscale_scale{256};
+
+  // @brief Apply a channel change to the GS sums
+  void update_sum(size_t colour_idx, uint16_t previous, uint16_t pwm) { m_gs_sum[colour_idx] = m_gs_sum[colour_idx] - previous + pwm; }
+
+  // @brief Estimate the current for a BC setting
+  uint32_t estimate_ua(const std::array<uint8_t, 3> &global_brightness) const
+  {
+    uint64_t total_na = 0;
+    // BC/MC arrays and GS channels share the blue, green, red order
+    for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+    {
+      const uint64_t full_scale_na =
+          output_full_scale_na(m_max_current[colour_idx], global_brightness[colour_idx], m_dot_correction);
+      total_na += (full_scale_na * m_gs_sum[colour_idx]) / 0xFFFF;
+    }
+    return static_cast<uint32_t>(total_na / 1000);
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_POWER_HPP__
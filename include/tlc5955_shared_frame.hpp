@@ -0,0 +1,201 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_SHARED_FRAME_HPP__
+#define __TLC5955_SHARED_FRAME_HPP__
+
+#if defined(__linux__)
+
+  #include <algorithm>
+  #include <atomic>
+  #include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief A GS frame that several producer threads write at the same time, one region (range of LEDs) each,
+// without locks (host only).
+//
+// Each region is owned by one producer and triple buffered: the producer writes its back buffer, and publish()
+// swaps it with the middle buffer in one atomic exchange and bumps the frame epoch. The transmit thread calls
+// snapshot(), which takes the newest published buffer of each region, so every region it sends is one whole
+// published update and is never torn by a producer that is still writing.
+// Regions never share bytes, so producers do not race each other. Only one thread may call snapshot().
+// @tparam NUM_CHIPS The number of daisy-chained chips
+// @tparam MAX_REGIONS The maximum number of regions
+template <size_t NUM_CHIPS, size_t MAX_REGIONS> class SharedFrame
+{
+public:
+  static_assert(NUM_CHIPS > 0, "SharedFrame needs at least one chip");
+  static_assert(MAX_REGIONS > 0, "SharedFrame needs at least one region");
+
+  // @brief The number of LEDs in the chain
+  static constexpr size_t m_num_leds{NUM_CHIPS * leds_per_chip};
+  // @brief The number of bytes in the frame
+  static constexpr size_t m_size_bytes{NUM_CHIPS * chip_frame_size_bytes};
+
+  // @brief Add a region. Call before the producer threads start.
+  // @param first_led The first LED of the region in the chain
+  // @param num_leds The number of LEDs in the region
+  // @return int The region index, or -1 if the region is empty, out of range, overlaps another or MAX_REGIONS is reached
+  int add_region(size_t first_led, size_t num_leds)
+  {
+    if (m_num_regions == MAX_REGIONS || num_leds == 0 || first_led >= m_num_leds || num_leds > m_num_leds - first_led)
+    {
+      return -1;
+    }
+    for (size_t region_idx = 0; region_idx < m_num_regions; region_idx++)
+    {
+      const Region &other = m_regions[region_idx];
+      if (first_led < other.first_led + other.num_leds && other.first_led < first_led + num_leds)
+      {
+        return -1;
+      }
+    }
+    m_regions[m_num_regions].first_led = first_led;
+    m_regions[m_num_regions].num_leds  = num_leds;
+    return static_cast<int>(m_num_regions++);
+  }
+
+  // @brief Get the number of regions
+  size_t get_num_regions() const { return m_num_regions; }
+
+  // @brief Set the RGB channels of an LED in the region's back buffer. Only the region's producer may call this.
+  // @param region_idx The region from add_region()
+  // @param led_idx Index of the LED in the region
+  // @return false if either index is out of range
+  bool set_rgb(size_t region_idx, size_t led_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    if (!(region_idx < m_num_regions) || !(led_idx < m_regions[region_idx].num_leds))
+    {
+      return false;
+    }
+    Region &region = m_regions[region_idx];
+    uint8_t *led   = &m_buffers[region.back][(region.first_led + led_idx) * colour_channels_per_led * 2];
+    write_channel(led + static_cast<size_t>(ColourChannel::blue) * 2, blue_pwm);
+    write_channel(led + static_cast<size_t>(ColourChannel::green) * 2, green_pwm);
+    write_channel(led + static_cast<size_t>(ColourChannel::red) * 2, red_pwm);
+    return true;
+  }
+
+  // @brief Set every LED in the region's back buffer to the same colour. Only the region's producer may call this.
+  // @param region_idx The region from add_region()
+  // @return false if region_idx is out of range
+  bool fill_rgb(size_t region_idx, uint16_t red_pwm, uint16_t green_pwm, uint16_t blue_pwm)
+  {
+    if (!(region_idx < m_num_regions))
+    {
+      return false;
+    }
+    for (size_t led_idx = 0; led_idx < m_regions[region_idx].num_leds; led_idx++)
+    {
+      set_rgb(region_idx, led_idx, red_pwm, green_pwm, blue_pwm);
+    }
+    return true;
+  }
+
+  // @brief Publish the region's back buffer to the transmit thread. Only the region's producer may call this.
+  // The new back buffer starts as a copy of the published one, so the producer can keep making partial updates.
+  // @param region_idx The region from add_region()
+  // @return false if region_idx is out of range
+  bool publish(size_t region_idx)
+  {
+    if (!(region_idx < m_num_regions))
+    {
+      return false;
+    }
+    Region &region          = m_regions[region_idx];
+    const uint8_t published = region.back;
+    region.back             = static_cast<uint8_t>(region.middle.exchange(published | m_fresh_flag, std::memory_order_acq_rel) & m_index_mask);
+    std::copy_n(region_bytes(region, published), region.num_leds * colour_channels_per_led * 2, region_bytes(region, region.back));
+    m_epoch.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  // @brief Get the number of publish() calls so far. The transmit thread can poll this to skip unchanged frames.
+  uint32_t get_epoch() const { return m_epoch.load(std::memory_order_acquire); }
+
+  // @brief Copy the newest published data of every region into a frame. Only the transmit thread may call this.
+  // LEDs outside every region are left unchanged.
+  // @param frame The frame to send
+  // @return uint32_t The epoch the snapshot is at least as new as
+  uint32_t snapshot(GreyscaleFrame<NUM_CHIPS> &frame)
+  {
+    const uint32_t epoch = get_epoch();
+    for (size_t region_idx = 0; region_idx < m_num_regions; region_idx++)
+    {
+      Region &region = m_regions[region_idx];
+      if ((region.middle.load(std::memory_order_relaxed) & m_fresh_flag) != 0)
+      {
+        region.front = static_cast<uint8_t>(region.middle.exchange(region.front, std::memory_order_acq_rel) & m_index_mask);
+      }
+      const size_t first_byte = region.first_led * colour_channels_per_led * 2;
+      std::copy_n(region_bytes(region, region.front), region.num_leds * colour_channels_per_led * 2, frame.data().begin() + first_byte);
+    }
+    return epoch;
+  }
+
+private:
+  // @brief Set in Region::middle when it holds data the transmit thread has not taken yet
+  static constexpr uint8_t m_fresh_flag{0x80};
+  // @brief The buffer index bits of Region::middle
+  static constexpr uint8_t m_index_mask{0x03};
+
+  // @brief One producer's range of LEDs and its triple buffer indices. Cache line aligned so producers
+  // publishing different regions do not share a line.
+  struct alignas(64) Region
+  {
+    size_t first_led{0};
+    size_t num_leds{0};
+    // @brief The buffer the producer writes
+    uint8_t back{0};
+    // @brief The last published buffer, swapped by both sides
+    std::atomic<uint8_t> middle{1};
+    // @brief The buffer the transmit thread reads
+    uint8_t front{2};
+  };
+
+  std::array<Region, MAX_REGIONS> m_regions{};
+  size_t m_num_regions{0};
+  std::atomic<uint32_t> m_epoch{0};
+  std::array<std::array<uint8_t, m_size_bytes>, 3> m_buffers{};
+
+  // @brief Get the start of a region in one of the buffers
+  uint8_t *region_bytes(const Region &region, uint8_t buffer_idx)
+  {
+    return m_buffers[buffer_idx].data() + region.first_led * colour_channels_per_led * 2;
+  }
+
+  // @brief Write a big-endian channel
+  static void write_channel(uint8_t *channel, uint16_t pwm)
+  {
+    channel[0] = static_cast<uint8_t>(pwm >> 8);
+    channel[1] = static_cast<uint8_t>(pwm & 0xFF);
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __linux__
+
+#endif // __TLC5955_SHARED_FRAME_HPP__
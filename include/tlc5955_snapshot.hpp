@@ -0,0 +1,206 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_SNAPSHOT_HPP__
+#define __TLC5955_SNAPSHOT_HPP__
+
+#include <tlc5955.hpp>
+#include <tlc5955_chain_control.hpp>
+#include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+namespace detail
+{
+
+constexpr std::array<uint32_t, 256> make_crc32_table()
+{
+  std::array<uint32_t, 256> table{};
+  for (uint32_t idx = 0; idx < table.size(); idx++)
+  {
+    uint32_t crc = idx;
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      crc = (crc & 0x1) ? ((crc >> 1) ^ 0xEDB88320U) : (crc >> 1);
+    }
+    table[idx] = crc;
+  }
+  return table;
+}
+
+} // namespace detail
+
+// @brief CRC-32 (IEEE 802.3) table in flash
+inline constexpr std::array<uint32_t, 256> crc32_table{detail::make_crc32_table()};
+
+// @brief Get the CRC-32 (IEEE 802.3) of some bytes
+// @param bytes The bytes to check
+// @param crc The CRC of the preceding bytes, to continue a CRC over several spans
+constexpr uint32_t crc32(std::span<const uint8_t> bytes, uint32_t crc = 0)
+{
+  crc = ~crc;
+  for (const uint8_t byte : bytes)
+  {
+    crc = crc32_table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+// @brief Saves the packed control and GS images of a chain to a persistent region (a flash page, backup SRAM or,
+// on the host, a file read into memory or mmap()'d), and restores them at boot so the panel lights up before
+// the rest of the application has started.
+//
+// Region layout: "TLC5" magic, format version (16-bit), number of chips (16-bit), the control stream, the GS frame,
+// then the CRC-32 of everything before it. Multi-byte fields are little-endian.
+// For flash, save() into a RAM buffer and program it as a page; restore() can read the flash directly.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class FrameSnapshot
+{
+public:
+  static_assert(NUM_CHIPS > 0 && NUM_CHIPS <= UINT16_MAX, "FrameSnapshot needs 1-65535 chips");
+
+  // @brief The snapshot format version
+  static constexpr uint16_t m_version{1};
+  // @brief The number of bytes before the images
+  static constexpr size_t m_header_size{8};
+  // @brief The number of bytes in each image
+  static constexpr size_t m_image_size{NUM_CHIPS * chip_frame_size_bytes};
+  // @brief The offset of the control stream
+  static constexpr size_t m_control_offset{m_header_size};
+  // @brief The offset of the GS frame
+  static constexpr size_t m_greyscale_offset{m_control_offset + m_image_size};
+  // @brief The offset of the CRC
+  static constexpr size_t m_crc_offset{m_greyscale_offset + m_image_size};
+  // @brief The number of bytes needed for the region
+  static constexpr size_t m_size_bytes{m_crc_offset + 4};
+
+  // @brief Write a snapshot
+  // @param region The persistent region. Must be at least m_size_bytes.
+  // @param control The packed control stream, e.g. ChainControl::data(). Must be NUM_CHIPS * 96 bytes.
+  // @param greyscale The packed GS frame, e.g. GreyscaleFrame::data(). Must be NUM_CHIPS * 96 bytes.
+  // @return false if any size is wrong
+  static bool save(std::span<uint8_t> region, std::span<const uint8_t> control, std::span<const uint8_t> greyscale)
+  {
+    if (region.size() < m_size_bytes || control.size() != m_image_size || greyscale.size() != m_image_size)
+    {
+      return false;
+    }
+    region[0] = 'T';
+    region[1] = 'L';
+    region[2] = 'C';
+    region[3] = '5';
+    write_le(region.subspan(4, 2), m_version);
+    write_le(region.subspan(6, 2), static_cast<uint16_t>(NUM_CHIPS));
+    std::copy(control.begin(), control.end(), region.begin() + m_control_offset);
+    std::copy(greyscale.begin(), greyscale.end(), region.begin() + m_greyscale_offset);
+    write_le(region.subspan(m_crc_offset, 4), crc32(region.first(m_crc_offset)));
+    return true;
+  }
+
+  // @brief Write a snapshot of a chain. Call ChainControl::pack() or update() first.
+  static bool save(std::span<uint8_t> region, const ChainControl<NUM_CHIPS> &control, const GreyscaleFrame<NUM_CHIPS> &greyscale)
+  {
+    return save(region, control.data(), greyscale.data());
+  }
+
+  // @brief Check the magic, version, chain length and CRC of a snapshot
+  // @param region The persistent region
+  static bool is_valid(std::span<const uint8_t> region)
+  {
+    if (region.size() < m_size_bytes || region[0] != 'T' || region[1] != 'L' || region[2] != 'C' || region[3] != '5' ||
+        read_le(region.subspan(4, 2)) != m_version || read_le(region.subspan(6, 2)) != NUM_CHIPS)
+    {
+      return false;
+    }
+    return read_le(region.subspan(m_crc_offset, 4)) == crc32(region.first(m_crc_offset));
+  }
+
+  // @brief Get the control stream of a snapshot. Check is_valid() first.
+  static std::span<const uint8_t> control_image(std::span<const uint8_t> region) { return region.subspan(m_control_offset, m_image_size); }
+
+  // @brief Get the GS frame of a snapshot. Check is_valid() first.
+  static std::span<const uint8_t> greyscale_image(std::span<const uint8_t> region)
+  {
+    return region.subspan(m_greyscale_offset, m_image_size);
+  }
+
+  // @brief Copy the GS frame of a snapshot into the application's frame, e.g. so rendering resumes from it
+  // @return false if the snapshot is not valid
+  static bool load_greyscale(std::span<const uint8_t> region, GreyscaleFrame<NUM_CHIPS> &greyscale)
+  {
+    if (!is_valid(region))
+    {
+      return false;
+    }
+    const auto image = greyscale_image(region);
+    std::copy(image.begin(), image.end(), greyscale.data().begin());
+    return true;
+  }
+
+  // @brief Verify a snapshot and latch it: the control stream is written twice (see Driver::update_control()),
+  // then the GS frame is sent and latched once. Configure GSCLK first.
+  // @param driver The driver for the chain
+  // @param region The persistent region
+  // @return false if the snapshot is not valid, and nothing is sent, or if the Driver rejected an image, and
+  // nothing more is sent
+  static bool restore(Driver &driver, std::span<const uint8_t> region)
+  {
+    if (!is_valid(region))
+    {
+      return false;
+    }
+    driver.invalidate_control();
+    for (uint8_t write_count = 0; write_count < 2; write_count++)
+    {
+      if (!driver.send_frame(control_image(region), Driver::DataLatchType::control, Driver::LatchPinOption::latch_after_send))
+      {
+        return false;
+      }
+    }
+    return driver.send_frame(greyscale_image(region), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send);
+  }
+
+private:
+  static void write_le(std::span<uint8_t> out, uint32_t value)
+  {
+    for (size_t byte_idx = 0; byte_idx < out.size(); byte_idx++)
+    {
+      out[byte_idx] = static_cast<uint8_t>(value >> (8 * byte_idx));
+    }
+  }
+
+  static uint32_t read_le(std::span<const uint8_t> in)
+  {
+    uint32_t value = 0;
+    for (size_t byte_idx = 0; byte_idx < in.size(); byte_idx++)
+    {
+      value |= static_cast<uint32_t>(in[byte_idx]) << (8 * byte_idx);
+    }
+    return value;
+  }
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_SNAPSHOT_HPP__
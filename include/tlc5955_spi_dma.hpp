@@ -0,0 +1,62 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_SPI_DMA_HPP__
+#define __TLC5955_SPI_DMA_HPP__
+
+#include <tlc5955.hpp>
+
+namespace tlc5955
+{
+
+// @brief Shifts one chip's 96 bytes out of a Driver's SPI peripheral from a DMA channel, so the CPU is free
+// (or can start other buses) while the chip is sent.
+//
+// The application must route the SPI TX DMA request to the DMA channel (DMAMUX on STM32G0).
+class SpiTxDma
+{
+public:
+  // @brief Construct a new SPI TX DMA object
+  // @param driver The driver whose SPI peripheral is fed
+  // @param tx_dma The DMA channel routed to the SPI TX request e.g. DMA1_Channel1
+  SpiTxDma(Driver &driver, DMA_Channel_TypeDef *tx_dma);
+
+  // @brief Start shifting out one chip. The first bit must already have been clocked.
+  // @param chip_bytes The chip data. Must stay unchanged until wait().
+  void start(std::span<const uint8_t, chip_frame_size_bytes> chip_bytes);
+
+  // @brief Block until the DMA transfer has finished and the SPI is idle. Returns at once if nothing was started.
+  void wait();
+
+private:
+  // @brief The driver whose SPI peripheral is fed
+  Driver &m_driver;
+  // @brief The DMA channel feeding the SPI TX FIFO
+  DMA_Channel_TypeDef &m_tx_dma;
+  // @brief true while a DMA transfer is in progress
+  bool m_busy{false};
+};
+
+} // namespace tlc5955
+
+#endif // __TLC5955_SPI_DMA_HPP__
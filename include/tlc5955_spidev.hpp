@@ -0,0 +1,172 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __TLC5955_SPIDEV_HPP__
+#define __TLC5955_SPIDEV_HPP__
+
+#if defined(__linux__)
+
+  #include <linux/spi/spidev.h>
+  #include <tlc5955_frame.hpp>
+
+namespace tlc5955
+{
+
+// @brief The number of bits shifted into each chip, including the first bit
+inline constexpr size_t chip_frame_size_bits{chip_frame_size_bytes * 8 + 1};
+
+// @brief The number of bytes needed to send a whole chain as one bitstream
+// @param num_chips The number of daisy-chained chips
+constexpr size_t chain_bitstream_size_bytes(size_t num_chips) { return (num_chips * chip_frame_size_bits + 7) / 8; }
+
+// @brief Pack chip data into one continuous bitstream with the first bit in front of each chip.
+// The bitstream is front-padded with zeros to a whole number of bytes; the padding is shifted
+// out of the far end of the chain, so no GPIO first bit is needed.
+// @param chain_bytes The chip data, 96 bytes per chip, in shift order
+// @param control_data true for a control data latch, false for GS data
+// @param bitstream The output. Must be chain_bitstream_size_bytes(num chips) bytes.
+// @return false if the sizes do not match
+bool pack_chain_bitstream(std::span<const uint8_t> chain_bytes, bool control_data, std::span<uint8_t> bitstream);
+
+// @brief The Linux system calls used by SpidevPort. Override to run against a fake device.
+class LinuxIo
+{
+public:
+  virtual ~LinuxIo() = default;
+  virtual int open(const char *path, int flags);
+  virtual int close(int fd);
+  virtual int ioctl(int fd, unsigned long request, void *arg);
+};
+
+// @brief Settings for SpidevPort
+struct SpidevConfig
+{
+  // @brief The spidev device node
+  const char *spi_device{"/dev/spidev0.0"};
+  // @brief SPI clock frequency
+  uint32_t speed_hz{10000000};
+  // @brief The gpiochip device node for the LAT line
+  const char *gpio_chip{"/dev/gpiochip0"};
+  // @brief The LAT line offset on the gpiochip
+  uint32_t lat_line{0};
+  // @brief Max bytes in one ioctl. Must not exceed the spidev "bufsiz" module parameter.
+  size_t max_message_bytes{4096};
+  // @brief Max bytes in one spi_ioc_transfer, for controllers with a smaller DMA limit
+  size_t max_transfer_bytes{4096};
+};
+
+// @brief A spidev SPI device and a gpiochip LAT line
+class SpidevPort
+{
+public:
+  // @brief Construct a new Spidev Port object
+  // @param io The system calls. Use a LinuxIo for real hardware.
+  // @param config The device nodes and bus settings
+  SpidevPort(LinuxIo &io, const SpidevConfig &config);
+
+  ~SpidevPort() { close(); }
+
+  SpidevPort(const SpidevPort &)            = delete;
+  SpidevPort &operator=(const SpidevPort &) = delete;
+
+  // @brief Open and configure the SPI device and request the LAT line as an output (low)
+  // @return false if any system call failed
+  bool open();
+
+  // @brief Release the LAT line and close the SPI device
+  void close();
+
+  // @brief Send bytes, batching the spi_ioc_transfers into as few ioctls as the max_message_bytes allows
+  // @return false if an ioctl failed or the port is not open
+  bool transfer(std::span<const uint8_t> bytes);
+
+  // @brief Pulse the LAT line
+  // @return false if an ioctl failed or the port is not open
+  bool latch();
+
+  // @brief The max number of spi_ioc_transfers in one ioctl
+  static constexpr size_t m_max_transfers_per_message{32};
+
+private:
+  // @brief The system calls
+  LinuxIo &m_io;
+  // @brief The device nodes and bus settings
+  SpidevConfig m_config;
+  // @brief The spidev file descriptor
+  int m_spi_fd{-1};
+  // @brief The LAT line request file descriptor
+  int m_lat_fd{-1};
+  // @brief The transfers for one ioctl
+  std::array<spi_ioc_transfer, m_max_transfers_per_message> m_transfers{};
+
+  // @brief Set the LAT line level
+  bool set_lat(bool level);
+};
+
+// @brief Sends a daisy chain of TLC5955 over Linux spidev.
+// The whole chain is packed into one bitstream and sent with one ioctl (per max_message_bytes),
+// followed by two ioctls for the LAT pulse, so the syscall count does not depend on the chain length.
+// @tparam NUM_CHIPS The number of daisy-chained chips
+template <size_t NUM_CHIPS> class SpidevTransport
+{
+public:
+  // @brief Construct a new Spidev Transport object
+  // @param port An open SpidevPort
+  explicit SpidevTransport(SpidevPort &port)
+      : m_port(port)
+  {
+  }
+
+  // @brief Send chip data for the whole chain, and options with/without latch
+  // @param chain_bytes 96 bytes per chip, in shift order
+  // @param control_data true for a control data latch, false for GS data
+  // @param latch true to pulse LAT after the send
+  // @return false if a system call failed
+  bool send(std::span<const uint8_t, NUM_CHIPS * chip_frame_size_bytes> chain_bytes, bool control_data, bool latch)
+  {
+    pack_chain_bitstream(chain_bytes, control_data, m_bitstream);
+    if (!m_port.transfer(m_bitstream))
+    {
+      return false;
+    }
+    return latch ? m_port.latch() : true;
+  }
+
+  // @brief Send a GreyscaleFrame, and options with/without latch
+  // @param frame The chain GS data
+  // @param latch true to pulse LAT after the send
+  // @return false if a system call failed
+  bool send(const GreyscaleFrame<NUM_CHIPS> &frame, bool latch) { return send(frame.data(), false, latch); }
+
+private:
+  // @brief The SPI device and LAT line
+  SpidevPort &m_port;
+  // @brief The packed bitstream
+  std::array<uint8_t, chain_bitstream_size_bytes(NUM_CHIPS)> m_bitstream{};
+};
+
+} // namespace tlc5955
+
+#endif // __linux__
+
+#endif // __TLC5955_SPIDEV_HPP__
@@ -0,0 +1,176 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __TLC5955_STATS_HPP__
+#define __TLC5955_STATS_HPP__
+
+#include <stdint.h>
+
+#if defined(X86_UNIT_TESTING_ONLY)
+  #include <chrono>
+#else
+  #include <stm32g0xx.h>
+#endif
+
+namespace tlc5955
+{
+
+// @brief Define TLC5955_ENABLE_STATS to build the Driver instrumentation counters.
+// When undefined the counters are empty types and every call compiles out.
+#if defined(TLC5955_ENABLE_STATS)
+inline constexpr bool stats_enabled{true};
+#else
+inline constexpr bool stats_enabled{false};
+#endif
+
+// @brief Snapshot of the Driver instrumentation counters.
+// Timings are in "ticks": CPU cycles on target, nanoseconds on X86.
+struct DriverStats
+{
+  // @brief number of chip frames (96 bytes) sent
+  uint32_t frames_sent{0};
+  // @brief number of bytes written to the SPI peripheral
+  uint32_t bytes_sent{0};
+  // @brief number of LAT pulses
+  uint32_t latch_pulses{0};
+  // @brief number of frames started with a control first bit
+  uint32_t control_frames{0};
+  // @brief number of frames started with a GS data first bit
+  uint32_t data_frames{0};
+  // @brief number of send_frame() calls skipped because the outputs were already blank
+  uint32_t blank_frames_skipped{0};
+  // @brief number of update_control() calls skipped because the control data was unchanged
+  uint32_t control_writes_skipped{0};
+  // @brief total ticks spent clocking out the first bit and switching MOSI/SCK between GPIO and SPI
+  uint64_t first_bit_ticks{0};
+  // @brief total ticks spent converting the bit register to the byte register
+  uint64_t packing_ticks{0};
+  // @brief total ticks spent blocking while the SPI sends bytes
+  uint64_t send_ticks{0};
+};
+
+namespace stats
+{
+
+// @brief Free-running tick source used for the instrumentation timings.
+// Cortex-M3/M4/M7: DWT CYCCNT.
+// Cortex-M0+: SysTick current value. Intervals are only valid up to one SysTick reload period.
+// X86: std::chrono::steady_clock in nanoseconds.
+class CycleCounter
+{
+public:
+  // @brief Enable the tick source (DWT only, SysTick is owned by the application).
+  // CYCCNT is left running as it is, so other Drivers and application profilers keep their intervals.
+  static void init()
+  {
+#if !defined(X86_UNIT_TESTING_ONLY) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR = CoreDebug->DEMCR | CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        = DWT->CTRL | DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  }
+
+  // @brief Get the current tick count
+  static uint32_t now()
+  {
+#if defined(X86_UNIT_TESTING_ONLY)
+    return static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#elif defined(DWT_CTRL_CYCCNTENA_Msk)
+    return DWT->CYCCNT;
+#else
+    return SysTick->VAL & SysTick_VAL_CURRENT_Msk;
+#endif
+  }
+
+  // @brief Get the ticks elapsed since start
+  // @param start The value previously returned by now()
+  static uint32_t elapsed(uint32_t start)
+  {
+    const uint32_t end = now();
+#if defined(X86_UNIT_TESTING_ONLY) || defined(DWT_CTRL_CYCCNTENA_Msk)
+    return end - start;
+#else
+    // SysTick counts down and wraps at LOAD
+    const uint32_t reload = (SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+    return (start >= end) ? (start - end) : (start + reload - end);
+#endif
+  }
+};
+
+// @brief The instrumentation counters. The primary template is the disabled (empty) version.
+template <bool ENABLED> class Counters
+{
+public:
+  void init() {}
+  void add_frame(uint32_t) {}
+  void add_latch() {}
+  void add_first_bit(bool) {}
+  void add_blank_skip() {}
+  void add_control_skip() {}
+  uint32_t start() { return 0; }
+  void add_first_bit_ticks(uint32_t) {}
+  void add_packing_ticks(uint32_t) {}
+  void add_send_ticks(uint32_t) {}
+  DriverStats snapshot() const { return DriverStats{}; }
+  void reset() {}
+};
+
+// @brief The enabled instrumentation counters
+template <> class Counters<true>
+{
+public:
+  void init() { CycleCounter::init(); }
+  void add_frame(uint32_t num_bytes)
+  {
+    m_stats.frames_sent++;
+    m_stats.bytes_sent += num_bytes;
+  }
+  void add_latch() { m_stats.latch_pulses++; }
+  void add_first_bit(bool control)
+  {
+    if (control)
+    {
+      m_stats.control_frames++;
+    }
+    else
+    {
+      m_stats.data_frames++;
+    }
+  }
+  void add_blank_skip() { m_stats.blank_frames_skipped++; }
+  void add_control_skip() { m_stats.control_writes_skipped++; }
+  uint32_t start() { return CycleCounter::now(); }
+  void add_first_bit_ticks(uint32_t start_ticks) { m_stats.first_bit_ticks += CycleCounter::elapsed(start_ticks); }
+  void add_packing_ticks(uint32_t start_ticks) { m_stats.packing_ticks += CycleCounter::elapsed(start_ticks); }
+  void add_send_ticks(uint32_t start_ticks) { m_stats.send_ticks += CycleCounter::elapsed(start_ticks); }
+  DriverStats snapshot() const { return m_stats; }
+  void reset() { m_stats = DriverStats{}; }
+
+private:
+  DriverStats m_stats{};
+};
+
+} // namespace stats
+
+} // namespace tlc5955
+
+#endif // __TLC5955_STATS_HPP__
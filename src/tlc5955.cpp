@@ -1,6 +1,7 @@
 
 #include "tlc5955.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -35,6 +36,8 @@ Driver::Driver(const DriverSerialInterface &serial_interface)
 #ifndef X86_UNIT_TESTING_ONLY
   #pragma GCC diagnostic pop
 #endif
+
+  m_stats.init();
 }
 
 void Driver::init(DisplayFunction display,
@@ -46,15 +49,8 @@ void Driver::init(DisplayFunction display,
                   std::array<uint8_t, 3> max_current,
                   uint8_t global_dot_correction)
 {
-
-  clear_register();
-  set_ctrl_cmd();
-  set_padding_bits();
-  set_function_cmd(display, timing, refresh, pwm, short_detect);
-
-  set_global_brightness_cmd(global_brightness[0], global_brightness[1], global_brightness[2]);
-  set_max_current_cmd(max_current[0], max_current[1], max_current[2]);
-  set_dot_correction_cmd_all(global_dot_correction);
+  const ControlData control{display, timing, refresh, pwm, short_detect, global_brightness, max_current, global_dot_correction};
+  set_control_register(control);
 
   // send data for top row (no latch)
   send_first_bit(DataLatchType::control);
@@ -63,6 +59,79 @@ void Driver::init(DisplayFunction display,
   // send data for bottom row
   send_first_bit(DataLatchType::control);
   send_spi_bytes(LatchPinOption::latch_after_send);
+
+  // the control latch needs two writes of the whole chain, and init() only latches once
+  m_control       = control;
+  m_control_valid = false;
+}
+
+bool Driver::update_control(const ControlData &control, uint16_t num_chips)
+{
+  if (num_chips == 0 || (m_control_valid && control == m_control))
+  {
+    m_stats.add_control_skip();
+    return false;
+  }
+
+  [[maybe_unused]] const uint32_t packing_start = m_stats.start();
+  std::array<uint8_t, chip_frame_size_bytes> control_bytes{};
+  pack_control(control, control_bytes);
+  m_stats.add_packing_ticks(packing_start);
+
+  // every chip gets the same control data, and the whole chain is written twice
+  for (uint8_t write_count = 0; write_count < 2; write_count++)
+  {
+    for (uint16_t chip_idx = 0; chip_idx < num_chips; chip_idx++)
+    {
+      shift_first_bit(DataLatchType::control);
+      send_bytes(control_bytes);
+    }
+    latch();
+  }
+
+  // shifting the first bit restarts GSCLK, so stop it again while blank
+  if (m_blanked && m_blank_frame_option == BlankFrameOption::skip_repeated_stop_gsclk)
+  {
+    enable_gsclk(false);
+  }
+
+  m_control       = control;
+  m_control_valid = true;
+  return true;
+}
+
+void Driver::pack_control(const ControlData &control, std::span<uint8_t, chip_frame_size_bytes> chip)
+{
+  std::fill(chip.begin(), chip.end(), 0);
+  write_frame_bits(chip, m_ctrl_cmd_offset, 0x96, m_ctrl_cmd_size);
+  // last padding bit set, as m_padding
+  write_frame_bits(chip, m_func_cmd_offset - 1, 0x1, 1);
+  write_frame_bits(chip, m_func_cmd_offset,
+                   function_cmd_bits(control.display, control.timing, control.refresh, control.pwm, control.short_detect),
+                   m_func_cmd_size);
+
+  for (size_t colour_idx = 0; colour_idx < m_num_colour_chan; colour_idx++)
+  {
+    write_frame_bits(chip, m_bc_data_offset + m_bc_data_size * colour_idx, control.global_brightness[colour_idx] & 0x7F,
+                     m_bc_data_size);
+    write_frame_bits(chip, m_mc_data_offset + m_mc_data_size * colour_idx, control.max_current[colour_idx] & 0x7, m_mc_data_size);
+  }
+  for (size_t channel_idx = 0; channel_idx < gs_channels_per_chip; channel_idx++)
+  {
+    write_frame_bits(chip, m_dc_data_offset + m_dc_data_size * channel_idx, control.dot_correction & 0x7F, m_dc_data_size);
+  }
+}
+
+void Driver::set_control_register(const ControlData &control)
+{
+  clear_register();
+  set_ctrl_cmd();
+  set_padding_bits();
+  set_function_cmd(control.display, control.timing, control.refresh, control.pwm, control.short_detect);
+
+  set_global_brightness_cmd(control.global_brightness[0], control.global_brightness[1], control.global_brightness[2]);
+  set_max_current_cmd(control.max_current[0], control.max_current[1], control.max_current[2]);
+  set_dot_correction_cmd_all(control.dot_correction);
 }
 
 // @brief class to implement TLC5955 LED Driver IC
@@ -73,17 +142,37 @@ void Driver::clear_register()
   m_common_byte_register.fill(0);
 }
 
-void Driver::send_first_bit(DataLatchType latch_type [[maybe_unused]])
+void Driver::send_first_bit(DataLatchType latch_type)
 {
+  [[maybe_unused]] const uint32_t packing_start = m_stats.start();
 #if not defined(X86_UNIT_TESTING_ONLY)
-
   // convert the bit buffer to bytes
   noarch::bit_manip::bitset_to_bytearray(m_common_byte_register, m_common_bit_register);
+#endif
+  m_stats.add_packing_ticks(packing_start);
+
+  shift_first_bit(latch_type);
+}
 
-  stm32::spi_ref::enable_spi(m_serial_interface.get_spi_handle(), false);
+void Driver::shift_first_bit(DataLatchType latch_type)
+{
+  m_stats.add_first_bit(latch_type == DataLatchType::control);
+  [[maybe_unused]] const uint32_t first_bit_start = m_stats.start();
+
+#if not defined(X86_UNIT_TESTING_ONLY)
+
+  if (m_shared_bus_configured)
+  {
+    // the rest of the bus is already set up, so only the pin modes change
+    set_spi_pin_mode(false);
+  }
+  else
+  {
+    stm32::spi_ref::enable_spi(m_serial_interface.get_spi_handle(), false);
 
-  // set PB7/PB8 as GPIO outputs
-  gpio_init();
+    // set PB7/PB8 as GPIO outputs
+    gpio_init();
+  }
 
   // make sure LAT pin is low otherwise first latch may be skipped (and TLC5955 will initialise intermittently)
   LL_GPIO_ResetOutputPin(&m_serial_interface.get_lat_port(), m_serial_interface.get_lat_pin());
@@ -120,10 +209,17 @@ void Driver::send_first_bit(DataLatchType latch_type [[maybe_unused]])
   }
 
   // set PB7/PB8 to SPI
-  spi2_init();
-  stm32::spi_ref::enable_spi(m_serial_interface.get_spi_handle());
-
+  if (m_shared_bus_configured)
+  {
+    set_spi_pin_mode(true);
+  }
+  else
+  {
+    spi_bus_init();
+  }
 #endif
+
+  m_stats.add_first_bit_ticks(first_bit_start);
 }
 
 void Driver::set_padding_bits() { noarch::bit_manip::insert_bitset_at_offset(m_common_bit_register, m_padding, m_padding_offset); }
@@ -132,13 +228,7 @@ void Driver::set_ctrl_cmd() { noarch::bit_manip::insert_bitset_at_offset(m_commo
 
 void Driver::set_function_cmd(DisplayFunction dsprpt, TimingFunction tmgrst, RefreshFunction rfresh, PwmFunction espwm, ShortDetectFunction lsdvlt)
 {
-  std::bitset<m_func_cmd_size> function_cmd{};
-  // don't use std::bitset.set(), this will force exception handling to bloat the linked .elf
-  (dsprpt == DisplayFunction::display_repeat_on) ? (function_cmd[4] = true) : (function_cmd[4] = false);
-  (tmgrst == TimingFunction::timing_reset_on) ? (function_cmd[3] = true) : (function_cmd[3] = false);
-  (rfresh == RefreshFunction::auto_refresh_on) ? (function_cmd[2] = true) : (function_cmd[2] = false);
-  (espwm == PwmFunction::enhanced_pwm) ? (function_cmd[1] = true) : (function_cmd[1] = false);
-  (lsdvlt == ShortDetectFunction::threshold_90_percent) ? (function_cmd[0] = true) : (function_cmd[0] = false);
+  const std::bitset<m_func_cmd_size> function_cmd{function_cmd_bits(dsprpt, tmgrst, rfresh, espwm, lsdvlt)};
   noarch::bit_manip::insert_bitset_at_offset(m_common_bit_register, function_cmd, m_func_cmd_offset);
 }
 
@@ -248,26 +338,212 @@ void Driver::set_position_and_colour(uint16_t position, LedColour colour)
   }
 }
 
-bool Driver::send_spi_bytes(LatchPinOption latch_option [[maybe_unused]])
+bool Driver::send_spi_bytes(LatchPinOption latch_option)
 {
-#if not defined(X86_UNIT_TESTING_ONLY)
-  // send the bytes
-  for (auto &byte : m_common_byte_register)
+  send_bytes(m_common_byte_register);
+
+  // tell each daisy-chained driver chip to latch all data from its common register
+  if (latch_option == LatchPinOption::latch_after_send)
   {
-    // send the byte of data
-    stm32::spi_ref::send_byte(m_serial_interface.get_spi_handle(), byte);
+    latch();
+  }
+  return true;
+}
+
+bool Driver::send_frame(std::span<const uint8_t> frame, DataLatchType latch_type, LatchPinOption latch_option, std::span<uint8_t> sout)
+{
+  if (frame.empty() || (frame.size() % m_common_reg_size_bytes) != 0 || (!sout.empty() && sout.size() != frame.size()))
+  {
+    return false;
+  }
+
+  const bool gating =
+      (latch_type == DataLatchType::data) && (m_blank_frame_option != BlankFrameOption::always_send) && sout.empty();
+  const bool blank  = gating && is_blank_frame(frame);
+  if (gating)
+  {
+    if (blank && m_blanked)
+    {
+      // the outputs already show this frame
+      m_stats.add_blank_skip();
+      return true;
+    }
+    if (!blank && m_blanked)
+    {
+      enable_gsclk(true);
+    }
+    m_blanked = false;
+  }
+
+  for (size_t chip_offset = 0; chip_offset < frame.size(); chip_offset += m_common_reg_size_bytes)
+  {
+    shift_first_bit(latch_type);
+    send_bytes(frame.subspan(chip_offset, m_common_reg_size_bytes),
+               sout.empty() ? sout : sout.subspan(chip_offset, m_common_reg_size_bytes));
   }
 
-  // tell each daisy-chained driver chip to latch all data from its common register
   if (latch_option == LatchPinOption::latch_after_send)
   {
-    LL_GPIO_SetOutputPin(&m_serial_interface.get_lat_port(), m_serial_interface.get_lat_pin());
-    LL_GPIO_ResetOutputPin(&m_serial_interface.get_lat_port(), m_serial_interface.get_lat_pin());
+    latch();
+    // a control latch leaves the GS data, and so the blank state, unchanged
+    if (latch_type == DataLatchType::data)
+    {
+      m_blanked = blank;
+    }
+  }
+
+  // shifting the first bit restarts GSCLK, so stop it again while blank (including after control writes)
+  if (m_blanked && m_blank_frame_option == BlankFrameOption::skip_repeated_stop_gsclk)
+  {
+    enable_gsclk(false);
   }
-#endif
   return true;
 }
 
+bool Driver::is_blank_frame(std::span<const uint8_t> frame)
+{
+  uint8_t running_or = 0;
+  for (const uint8_t byte : frame)
+  {
+    running_or = static_cast<uint8_t>(running_or | byte);
+  }
+  return running_or == 0;
+}
+
+void Driver::enable_gsclk(bool enable)
+{
+  TIM_TypeDef &gsclk_tim = m_serial_interface.get_gsclk_handle();
+  gsclk_tim.CR1          = enable ? (gsclk_tim.CR1 | TIM_CR1_CEN) : (gsclk_tim.CR1 & ~TIM_CR1_CEN);
+}
+
+void Driver::send_bytes(std::span<const uint8_t> bytes [[maybe_unused]], std::span<uint8_t> sout [[maybe_unused]])
+{
+  m_stats.add_frame(static_cast<uint32_t>(bytes.size()));
+  [[maybe_unused]] const uint32_t send_start = m_stats.start();
+
+#if not defined(X86_UNIT_TESTING_ONLY)
+
+  if (!sout.empty() && m_serial_interface.get_miso_port() != nullptr)
+  {
+    SPI_TypeDef &spi                  = m_serial_interface.get_spi_handle();
+    volatile uint8_t *const data_8bit = reinterpret_cast<volatile uint8_t *>(&spi.DR);
+    // drop anything left in the RX FIFO
+    while ((spi.SR & SPI_SR_RXNE) == SPI_SR_RXNE)
+    {
+      static_cast<void>(*data_8bit);
+    }
+    // keep the TX FIFO fed, but never more than 3 bytes ahead so the 4 byte RX FIFO cannot overrun
+    size_t tx_idx = 0;
+    size_t rx_idx = 0;
+    while (rx_idx < bytes.size())
+    {
+      if (tx_idx < bytes.size() && (tx_idx - rx_idx) < 3 && (spi.SR & SPI_SR_TXE) == SPI_SR_TXE)
+      {
+        *data_8bit = bytes[tx_idx++];
+      }
+      if ((spi.SR & SPI_SR_RXNE) == SPI_SR_RXNE)
+      {
+        sout[rx_idx++] = *data_8bit;
+      }
+    }
+  }
+  else if (m_spi_frame_mode == SpiFrameMode::packed_half_words)
+  {
+    SPI_TypeDef &spi                    = m_serial_interface.get_spi_handle();
+    volatile uint16_t *const data_16bit = reinterpret_cast<volatile uint16_t *>(&spi.DR);
+    // DS stays 8-bit, so the FIFO sends the low byte first (see spi_half_word()). TXE means at least 2 bytes are free.
+    size_t byte_idx = 0;
+    for (; byte_idx + 1 < bytes.size(); byte_idx += 2)
+    {
+      while ((spi.SR & SPI_SR_TXE) != SPI_SR_TXE)
+      {
+      }
+      *data_16bit = spi_half_word(bytes[byte_idx], bytes[byte_idx + 1]);
+    }
+    if (byte_idx < bytes.size())
+    {
+      stm32::spi_ref::send_byte(spi, bytes[byte_idx]);
+    }
+  }
+  else
+  {
+    // send the bytes
+    for (auto &byte : bytes)
+    {
+      // send the byte of data
+      stm32::spi_ref::send_byte(m_serial_interface.get_spi_handle(), byte);
+    }
+  }
+  // wait for the last byte before the pins are switched back to GPIO
+  spi_wait_idle();
+#endif
+
+  m_stats.add_send_ticks(send_start);
+}
+
+void Driver::spi_wait_idle()
+{
+#if not defined(X86_UNIT_TESTING_ONLY)
+  while ((m_serial_interface.get_spi_handle().SR & SPI_SR_FTLVL) != 0)
+  {
+  }
+  while ((m_serial_interface.get_spi_handle().SR & SPI_SR_BSY) == SPI_SR_BSY)
+  {
+  }
+#endif
+}
+
+void Driver::latch()
+{
+  m_stats.add_latch();
+#if not defined(X86_UNIT_TESTING_ONLY)
+  LL_GPIO_SetOutputPin(&m_serial_interface.get_lat_port(), m_serial_interface.get_lat_pin());
+  LL_GPIO_ResetOutputPin(&m_serial_interface.get_lat_port(), m_serial_interface.get_lat_pin());
+#endif
+}
+
+GsclkTiming Driver::configure_gsclk(uint32_t timer_clock_hz, uint32_t target_refresh_hz, PwmFunction pwm)
+{
+  const uint32_t gsclk_per_period = (pwm == PwmFunction::enhanced_pwm) ? gsclk_per_period_enhanced_pwm : gsclk_per_period_normal_pwm;
+  const GsclkTiming timing        = calculate_gsclk_timing(timer_clock_hz, target_refresh_hz, gsclk_per_period);
+  if (timing.gsclk_hz == 0)
+  {
+    return timing;
+  }
+
+  TIM_TypeDef &gsclk_tim = m_serial_interface.get_gsclk_handle();
+  gsclk_tim.PSC          = timing.prescaler;
+  gsclk_tim.ARR          = timing.auto_reload;
+
+  // PWM mode 1 with compare preload on the GSCLK output channel
+  switch (m_serial_interface.get_gsclk_tim_ch())
+  {
+    case TIM_CCER_CC1E:
+      gsclk_tim.CCR1  = timing.compare;
+      gsclk_tim.CCMR1 = (gsclk_tim.CCMR1 & ~TIM_CCMR1_OC1M) | (6U << TIM_CCMR1_OC1M_Pos) | TIM_CCMR1_OC1PE;
+      break;
+    case TIM_CCER_CC2E:
+      gsclk_tim.CCR2  = timing.compare;
+      gsclk_tim.CCMR1 = (gsclk_tim.CCMR1 & ~TIM_CCMR1_OC2M) | (6U << TIM_CCMR1_OC2M_Pos) | TIM_CCMR1_OC2PE;
+      break;
+    case TIM_CCER_CC3E:
+      gsclk_tim.CCR3  = timing.compare;
+      gsclk_tim.CCMR2 = (gsclk_tim.CCMR2 & ~TIM_CCMR2_OC3M) | (6U << TIM_CCMR2_OC3M_Pos) | TIM_CCMR2_OC3PE;
+      break;
+    case TIM_CCER_CC4E:
+      gsclk_tim.CCR4  = timing.compare;
+      gsclk_tim.CCMR2 = (gsclk_tim.CCMR2 & ~TIM_CCMR2_OC4M) | (6U << TIM_CCMR2_OC4M_Pos) | TIM_CCMR2_OC4PE;
+      break;
+    default:
+      break;
+  }
+
+  // buffer ARR and load the new settings now
+  gsclk_tim.CR1 = gsclk_tim.CR1 | TIM_CR1_ARPE;
+  gsclk_tim.EGR = TIM_EGR_UG;
+  return timing;
+}
+
 void Driver::gpio_init(void)
 {
 #if not defined(X86_UNIT_TESTING_ONLY)
@@ -312,19 +588,68 @@ void Driver::spi2_init(void)
   LL_GPIO_SetPinMode(&m_serial_interface.get_sck_port(), m_serial_interface.get_sck_pin(), LL_GPIO_MODE_ALTERNATE);
 
   m_serial_interface.get_spi_handle().CR1 = 0;
-  m_serial_interface.get_spi_handle().CR1 |= ((SPI_CR1_BIDIMODE | SPI_CR1_BIDIOE) | (SPI_CR1_MSTR | SPI_CR1_SSI) | SPI_CR1_SSM | SPI_CR1_BR_1);
+  if (m_serial_interface.get_miso_port() != nullptr)
+  {
+    // Enable GPIO (SPI_MISO) and run full-duplex to capture SOUT
+    GPIO_TypeDef &miso_port = *m_serial_interface.get_miso_port();
+    const uint16_t miso_pin = m_serial_interface.get_miso_pin();
+    LL_GPIO_SetPinPull(&miso_port, miso_pin, LL_GPIO_PULL_DOWN);
+    if (miso_pin < (1U << 8))
+    {
+      LL_GPIO_SetAFPin_0_7(&miso_port, miso_pin, m_serial_interface.get_miso_af());
+    }
+    else
+    {
+      LL_GPIO_SetAFPin_8_15(&miso_port, miso_pin, m_serial_interface.get_miso_af());
+    }
+    LL_GPIO_SetPinMode(&miso_port, miso_pin, LL_GPIO_MODE_ALTERNATE);
+
+    m_serial_interface.get_spi_handle().CR1 |= ((SPI_CR1_MSTR | SPI_CR1_SSI) | SPI_CR1_SSM | SPI_CR1_BR_1);
+    // RXNE after each byte
+    SET_BIT(m_serial_interface.get_spi_handle().CR2, SPI_CR2_FRXTH);
+  }
+  else
+  {
+    m_serial_interface.get_spi_handle().CR1 |= ((SPI_CR1_BIDIMODE | SPI_CR1_BIDIOE) | (SPI_CR1_MSTR | SPI_CR1_SSI) | SPI_CR1_SSM | SPI_CR1_BR_1);
+  }
 
   CLEAR_BIT(m_serial_interface.get_spi_handle().CR2, SPI_CR2_NSSP);
+  // 8-bit data frames, also used by SpiFrameMode::packed_half_words
+  MODIFY_REG(m_serial_interface.get_spi_handle().CR2, SPI_CR2_DS, (0x7U << SPI_CR2_DS_Pos));
 
+  gsclk_output_init();
+
+  #pragma GCC diagnostic pop // ignored "-Wvolatile"
+#endif                       // not X86_UNIT_TESTING_ONLY
+}
+
+void Driver::spi_bus_init(void)
+{
+  spi2_init();
+#if not defined(X86_UNIT_TESTING_ONLY)
+  stm32::spi_ref::enable_spi(m_serial_interface.get_spi_handle());
+#endif // not X86_UNIT_TESTING_ONLY
+}
+
+void Driver::gsclk_output_init(void)
+{
+#if not defined(X86_UNIT_TESTING_ONLY)
   // Enable the PWM OC channel
   m_serial_interface.get_gsclk_handle().CCER = m_serial_interface.get_gsclk_handle().CCER | m_serial_interface.get_gsclk_tim_ch();
   // required to enable output on some timers. e.g. TIM16
   m_serial_interface.get_gsclk_handle().BDTR = m_serial_interface.get_gsclk_handle().BDTR | TIM_BDTR_MOE;
   // Enable the timer
   m_serial_interface.get_gsclk_handle().CR1 = m_serial_interface.get_gsclk_handle().CR1 | TIM_CR1_CEN;
+#endif // not X86_UNIT_TESTING_ONLY
+}
 
-  #pragma GCC diagnostic pop // ignored "-Wvolatile"
-#endif                       // not X86_UNIT_TESTING_ONLY
+void Driver::set_spi_pin_mode([[maybe_unused]] bool spi)
+{
+#if not defined(X86_UNIT_TESTING_ONLY)
+  const uint32_t mode = spi ? LL_GPIO_MODE_ALTERNATE : LL_GPIO_MODE_OUTPUT;
+  LL_GPIO_SetPinMode(&m_serial_interface.get_mosi_port(), m_serial_interface.get_mosi_pin(), mode);
+  LL_GPIO_SetPinMode(&m_serial_interface.get_sck_port(), m_serial_interface.get_sck_pin(), mode);
+#endif // not X86_UNIT_TESTING_ONLY
 }
 
 } // namespace tlc5955
\ No newline at end of file
@@ -0,0 +1,197 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_chain_renderer.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+
+namespace tlc5955
+{
+
+namespace
+{
+
+// the frame epoch in the high 16 bits, then back (exclusive) and front in 24 bits each
+uint64_t make_range(uint32_t epoch, uint32_t front, uint32_t back)
+{
+  return (static_cast<uint64_t>(epoch & 0xFFFF) << 48) | (static_cast<uint64_t>(back) << 24) | front;
+}
+
+uint32_t range_epoch(uint64_t range) { return static_cast<uint32_t>(range >> 48); }
+
+uint32_t range_front(uint64_t range) { return static_cast<uint32_t>(range & 0xFFFFFF); }
+
+uint32_t range_back(uint64_t range) { return static_cast<uint32_t>((range >> 24) & 0xFFFFFF); }
+
+} // namespace
+
+ChainSetRenderer::ChainSetRenderer(size_t num_chains, size_t scratch_bytes, ChainJob job, size_t num_workers)
+    : m_num_chains(num_chains),
+      m_num_workers(num_workers),
+      m_job(std::move(job))
+{
+  if (m_num_workers == 0)
+  {
+    m_num_workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_shares = std::make_unique<WorkerShare[]>(m_num_workers);
+  m_scratch.resize(m_num_workers, std::vector<uint8_t>(scratch_bytes, 0));
+  for (size_t worker_idx = 1; worker_idx < m_num_workers; worker_idx++)
+  {
+    m_threads.emplace_back(&ChainSetRenderer::run_worker, this, worker_idx);
+  }
+}
+
+ChainSetRenderer::~ChainSetRenderer()
+{
+  m_stop.store(true);
+  m_epoch.fetch_add(1);
+  m_epoch.notify_all();
+  for (std::thread &thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+bool ChainSetRenderer::render_frame()
+{
+  // shares hold 24-bit chain indexes
+  if (m_num_chains > max_chains)
+  {
+    return false;
+  }
+  if (m_num_chains == 0)
+  {
+    return true;
+  }
+
+  // reset the count before the chains are published, so every chain of this frame is counted against it
+  m_remaining.store(m_num_chains);
+
+  // split the chains evenly; stealing evens out chains that take longer.
+  // Ranges are tagged with the new epoch, so a worker still finishing the last frame cannot take from them.
+  // Release: a worker that takes a chain sees everything written before render_frame().
+  const uint32_t epoch = m_epoch.load() + 1;
+  for (size_t worker_idx = 0; worker_idx < m_num_workers; worker_idx++)
+  {
+    const uint32_t front = static_cast<uint32_t>(m_num_chains * worker_idx / m_num_workers);
+    const uint32_t back  = static_cast<uint32_t>(m_num_chains * (worker_idx + 1) / m_num_workers);
+    m_shares[worker_idx].range.store(make_range(epoch, front, back), std::memory_order_release);
+  }
+
+  m_epoch.store(epoch);
+  m_epoch.notify_all();
+
+  work(0, epoch);
+
+  size_t remaining = m_remaining.load();
+  while (remaining != 0)
+  {
+    m_remaining.wait(remaining);
+    remaining = m_remaining.load();
+  }
+  return true;
+}
+
+void ChainSetRenderer::run_worker(size_t worker_idx)
+{
+  uint32_t epoch = 0;
+  while (true)
+  {
+    m_epoch.wait(epoch);
+    epoch = m_epoch.load();
+    if (m_stop.load())
+    {
+      return;
+    }
+    // leave work() when this frame's shares are empty, then wait for the next epoch
+    work(worker_idx, epoch);
+  }
+}
+
+void ChainSetRenderer::work(size_t worker_idx, uint32_t epoch)
+{
+  std::span<uint8_t> scratch(m_scratch[worker_idx]);
+  uint32_t chain_idx = 0;
+  while (true)
+  {
+    bool found = take_front(worker_idx, epoch, chain_idx);
+    for (size_t offset = 1; !found && offset < m_num_workers; offset++)
+    {
+      found = take_back((worker_idx + offset) % m_num_workers, epoch, chain_idx);
+      if (found)
+      {
+        m_steal_count.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    if (!found)
+    {
+      return;
+    }
+
+    m_job(chain_idx, scratch);
+    if (m_remaining.fetch_sub(1) == 1)
+    {
+      m_remaining.notify_all();
+    }
+  }
+}
+
+bool ChainSetRenderer::take_front(size_t worker_idx, uint32_t epoch, uint32_t &chain_idx)
+{
+  std::atomic<uint64_t> &range = m_shares[worker_idx].range;
+  uint64_t current             = range.load(std::memory_order_acquire);
+  // only take chains from the frame this worker was started for
+  while (range_epoch(current) == (epoch & 0xFFFF) && range_front(current) < range_back(current))
+  {
+    if (range.compare_exchange_weak(current, make_range(epoch, range_front(current) + 1, range_back(current)), std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      chain_idx = range_front(current);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChainSetRenderer::take_back(size_t worker_idx, uint32_t epoch, uint32_t &chain_idx)
+{
+  std::atomic<uint64_t> &range = m_shares[worker_idx].range;
+  uint64_t current             = range.load(std::memory_order_acquire);
+  // only take chains from the frame this worker was started for
+  while (range_epoch(current) == (epoch & 0xFFFF) && range_front(current) < range_back(current))
+  {
+    if (range.compare_exchange_weak(current, make_range(epoch, range_front(current), range_back(current) - 1), std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+      chain_idx = range_back(current) - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace tlc5955
+
+#endif // __linux__
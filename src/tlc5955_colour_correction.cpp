@@ -0,0 +1,97 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_colour_correction.hpp"
+
+namespace tlc5955
+{
+
+ColourCorrector::ColourCorrector(const GammaTable &gamma, std::span<const ColourMatrix> matrices,
+                                 std::span<const uint8_t> led_matrix_idx)
+    : m_gamma(gamma),
+      m_matrices(matrices),
+      m_led_matrix_idx(led_matrix_idx)
+{
+}
+
+void ColourCorrector::set_brightness(uint16_t brightness) { m_brightness = (brightness > 256) ? 256 : brightness; }
+
+const ColourMatrix *ColourCorrector::matrix_for(size_t led_idx) const
+{
+  if (m_matrices.empty())
+  {
+    return nullptr;
+  }
+  if (!m_led_matrix_idx.empty())
+  {
+    if (!(led_idx < m_led_matrix_idx.size()) || !(m_led_matrix_idx[led_idx] < m_matrices.size()))
+    {
+      return &identity_colour_matrix;
+    }
+    return &m_matrices[m_led_matrix_idx[led_idx]];
+  }
+  return (led_idx < m_matrices.size()) ? &m_matrices[led_idx] : &identity_colour_matrix;
+}
+
+bool ColourCorrector::pack(std::span<const uint8_t> rgb, std::span<uint8_t> gs_bytes, size_t first_led) const
+{
+  if ((rgb.size() % colour_channels_per_led) != 0 || gs_bytes.size() != rgb.size() * 2)
+  {
+    return false;
+  }
+
+  // GS channel order within each LED, for output rows red, green, blue
+  constexpr std::array<size_t, colour_channels_per_led> row_to_channel{
+      static_cast<size_t>(ColourChannel::red), static_cast<size_t>(ColourChannel::green),
+      static_cast<size_t>(ColourChannel::blue)};
+
+  const size_t num_leds = rgb.size() / colour_channels_per_led;
+  for (size_t led_idx = 0; led_idx < num_leds; led_idx++)
+  {
+    const uint8_t *levels = &rgb[led_idx * colour_channels_per_led];
+    const std::array<int32_t, colour_channels_per_led> linear{m_gamma[levels[0]], m_gamma[levels[1]], m_gamma[levels[2]]};
+    const ColourMatrix *matrix = matrix_for(first_led + led_idx);
+    uint8_t *led_bytes         = &gs_bytes[led_idx * colour_channels_per_led * 2];
+
+    for (size_t row = 0; row < colour_channels_per_led; row++)
+    {
+      int32_t pwm = linear[row];
+      if (matrix != nullptr)
+      {
+        // at most 3 * 2^13 * (2^16 - 1): no overflow
+        const int16_t *coefficients = &matrix->coefficients[row * colour_channels_per_led];
+        const int32_t sum = coefficients[0] * linear[0] + coefficients[1] * linear[1] + coefficients[2] * linear[2];
+        pwm               = (sum + colour_matrix_one / 2) / colour_matrix_one;
+        pwm               = (pwm < 0) ? 0 : ((pwm > 0xFFFF) ? 0xFFFF : pwm);
+      }
+      pwm = (pwm * m_brightness) >> 8;
+
+      uint8_t *channel = led_bytes + row_to_channel[row] * 2;
+      channel[0]       = static_cast<uint8_t>(pwm >> 8);
+      channel[1]       = static_cast<uint8_t>(pwm & 0xFF);
+    }
+  }
+  return true;
+}
+
+} // namespace tlc5955
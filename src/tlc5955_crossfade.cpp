@@ -0,0 +1,113 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_crossfade.hpp"
+
+#include <bit>
+
+namespace tlc5955
+{
+
+bool crossfade(std::span<const uint8_t> from, std::span<const uint8_t> to, uint16_t weight, std::span<uint8_t> out)
+{
+  if (from.size() != to.size() || from.size() != out.size() || (from.size() % 2) != 0)
+  {
+    return false;
+  }
+  if (weight > crossfade_weight_max)
+  {
+    weight = crossfade_weight_max;
+  }
+
+#if UINTPTR_MAX == 0xFFFFFFFF
+  const uintptr_t alignment =
+      reinterpret_cast<uintptr_t>(from.data()) | reinterpret_cast<uintptr_t>(to.data()) | reinterpret_cast<uintptr_t>(out.data());
+  if ((alignment % 4) == 0)
+  {
+    const size_t num_words = from.size() / 4;
+    detail::crossfade_words(from.data(), to.data(), weight, out.data(), num_words);
+    // a trailing odd channel
+    detail::crossfade_channels(from.data() + num_words * 4, to.data() + num_words * 4, weight, out.data() + num_words * 4,
+                               (from.size() % 4) / 2);
+    return true;
+  }
+#endif
+
+  detail::crossfade_channels(from.data(), to.data(), weight, out.data(), from.size() / 2);
+  return true;
+}
+
+namespace detail
+{
+
+void crossfade_channels(const uint8_t *from, const uint8_t *to, uint16_t weight, uint8_t *out, size_t num_channels)
+{
+  const uint32_t from_weight = crossfade_weight_max - weight;
+  for (size_t channel_idx = 0; channel_idx < num_channels; channel_idx++)
+  {
+    const uint32_t from_pwm = static_cast<uint32_t>((from[channel_idx * 2] << 8) | from[channel_idx * 2 + 1]);
+    const uint32_t to_pwm   = static_cast<uint32_t>((to[channel_idx * 2] << 8) | to[channel_idx * 2 + 1]);
+    const uint32_t mix      = (from_pwm * from_weight + to_pwm * weight) >> 8;
+    out[channel_idx * 2]     = static_cast<uint8_t>(mix >> 8);
+    out[channel_idx * 2 + 1] = static_cast<uint8_t>(mix & 0xFF);
+  }
+}
+
+void crossfade_words(const uint8_t *from, const uint8_t *to, uint16_t weight, uint8_t *out, size_t num_words)
+{
+  // Each word holds two big-endian channels: hi0 lo0 hi1 lo1.
+  // Splitting it into the high bytes and the low bytes gives two 16-bit lanes each,
+  // and since the weights sum to 256 a blended byte (at most 255 * 256) never carries into the next lane.
+  // The blended channel is then hi_mix + (lo_mix >> 8), which is exact.
+  constexpr uint32_t lane_mask = 0x00FF00FF;
+  constexpr bool little_endian = (std::endian::native == std::endian::little);
+  const uint32_t from_weight   = crossfade_weight_max - weight;
+
+  const uint32_t *from_words = static_cast<const uint32_t *>(__builtin_assume_aligned(from, 4));
+  const uint32_t *to_words   = static_cast<const uint32_t *>(__builtin_assume_aligned(to, 4));
+  uint32_t *out_words        = static_cast<uint32_t *>(__builtin_assume_aligned(out, 4));
+  for (size_t word_idx = 0; word_idx < num_words; word_idx++)
+  {
+    uint32_t from_word;
+    uint32_t to_word;
+    __builtin_memcpy(&from_word, from_words + word_idx, sizeof(uint32_t));
+    __builtin_memcpy(&to_word, to_words + word_idx, sizeof(uint32_t));
+
+    const uint32_t from_hi = little_endian ? (from_word & lane_mask) : ((from_word >> 8) & lane_mask);
+    const uint32_t from_lo = little_endian ? ((from_word >> 8) & lane_mask) : (from_word & lane_mask);
+    const uint32_t to_hi   = little_endian ? (to_word & lane_mask) : ((to_word >> 8) & lane_mask);
+    const uint32_t to_lo   = little_endian ? ((to_word >> 8) & lane_mask) : (to_word & lane_mask);
+
+    const uint32_t hi_mix = from_hi * from_weight + to_hi * weight;
+    const uint32_t lo_mix = from_lo * from_weight + to_lo * weight;
+    const uint32_t mix    = hi_mix + ((lo_mix >> 8) & lane_mask);
+
+    // back to big-endian channels
+    const uint32_t out_word = little_endian ? (((mix & lane_mask) << 8) | ((mix >> 8) & lane_mask)) : mix;
+    __builtin_memcpy(out_words + word_idx, &out_word, sizeof(uint32_t));
+  }
+}
+
+} // namespace detail
+
+} // namespace tlc5955
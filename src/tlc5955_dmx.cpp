@@ -0,0 +1,380 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_dmx.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__linux__)
+  #include <arpa/inet.h>
+  #include <poll.h>
+  #include <unistd.h>
+#endif
+
+namespace tlc5955
+{
+
+namespace
+{
+
+// @brief Art-Net packet ID
+constexpr std::array<uint8_t, 8> artnet_id{'A', 'r', 't', '-', 'N', 'e', 't', 0};
+// @brief Art-Net OpDmx
+constexpr uint16_t artnet_op_dmx{0x5000};
+// @brief Art-Net OpSync
+constexpr uint16_t artnet_op_sync{0x5200};
+// @brief Art-Net DMX data offset
+constexpr size_t artnet_dmx_header_size{18};
+// @brief The sync address recorded for Art-Net universes. ArtSync has no address and syncs every Art-Net universe;
+// sACN sync addresses are universe numbers (1-63999) so never match it.
+constexpr uint16_t artnet_sync_address{0xFFFF};
+
+// @brief E1.31 ACN packet identifier
+constexpr std::array<uint8_t, 12> sacn_acn_id{'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+// @brief E1.31 root layer vector for data packets
+constexpr uint32_t sacn_root_vector_data{0x00000004};
+// @brief E1.31 root layer vector for extended (sync) packets
+constexpr uint32_t sacn_root_vector_extended{0x00000008};
+// @brief E1.31 framing layer vector for data packets
+constexpr uint32_t sacn_framing_vector_data{0x00000002};
+// @brief E1.31 framing layer vector for sync packets
+constexpr uint32_t sacn_framing_vector_sync{0x00000001};
+// @brief E1.31 data packet synchronization address offset
+constexpr size_t sacn_data_sync_address_offset{109};
+// @brief E1.31 sync packet synchronization address offset
+constexpr size_t sacn_sync_address_offset{45};
+// @brief E1.31 preview data option bit
+constexpr uint8_t sacn_option_preview{0x80};
+// @brief E1.31 DMX start code offset (the slots follow it)
+constexpr size_t sacn_start_code_offset{125};
+// @brief E1.31 sync packet size
+constexpr size_t sacn_sync_packet_size{49};
+
+// @brief DMX slots per universe
+constexpr size_t dmx_max_slots{512};
+
+uint16_t read_be16(std::span<const uint8_t> packet, size_t offset)
+{
+  return static_cast<uint16_t>((packet[offset] << 8) | packet[offset + 1]);
+}
+
+uint32_t read_be32(std::span<const uint8_t> packet, size_t offset)
+{
+  return (static_cast<uint32_t>(read_be16(packet, offset)) << 16) | read_be16(packet, offset + 2);
+}
+
+} // namespace
+
+DmxDecoder::DmxDecoder(std::span<uint8_t> gs_bytes, std::span<const DmxUniverseMap> universe_map, const GammaTable &gamma)
+    : m_gs_bytes(gs_bytes),
+      m_universe_map(universe_map.first(std::min(universe_map.size(), m_max_map_entries))),
+      m_gamma(gamma)
+{
+}
+
+DmxDecoder::Packet DmxDecoder::decode(std::span<const uint8_t> packet)
+{
+  if (packet.size() >= artnet_id.size() && std::equal(artnet_id.begin(), artnet_id.end(), packet.begin()))
+  {
+    return decode_artnet(packet);
+  }
+  if (packet.size() >= 16 && std::equal(sacn_acn_id.begin(), sacn_acn_id.end(), packet.begin() + 4))
+  {
+    return decode_sacn(packet);
+  }
+  return Packet::invalid;
+}
+
+bool DmxDecoder::take_frame_ready()
+{
+  const bool ready = m_frame_ready;
+  m_frame_ready    = false;
+  return ready;
+}
+
+DmxDecoder::Packet DmxDecoder::decode_artnet(std::span<const uint8_t> packet)
+{
+  if (packet.size() < 12)
+  {
+    return Packet::invalid;
+  }
+
+  // OpCode is little-endian
+  const uint16_t op_code = static_cast<uint16_t>(packet[8] | (packet[9] << 8));
+  if (op_code == artnet_op_sync)
+  {
+    return sync(artnet_sync_address);
+  }
+  if (op_code != artnet_op_dmx)
+  {
+    return Packet::ignored;
+  }
+  if (packet.size() < artnet_dmx_header_size)
+  {
+    return Packet::invalid;
+  }
+
+  // 15-bit port address: Net (7 bits) then SubUni (8 bits)
+  const uint16_t universe = static_cast<uint16_t>(packet[14] | ((packet[15] & 0x7F) << 8));
+  const size_t length     = std::min<size_t>({read_be16(packet, 16), packet.size() - artnet_dmx_header_size, dmx_max_slots});
+  return write_universe(universe, packet.subspan(artnet_dmx_header_size, length), artnet_sync_address);
+}
+
+DmxDecoder::Packet DmxDecoder::decode_sacn(std::span<const uint8_t> packet)
+{
+  if (packet.size() < 44)
+  {
+    return Packet::invalid;
+  }
+
+  const uint32_t root_vector    = read_be32(packet, 18);
+  const uint32_t framing_vector = read_be32(packet, 40);
+  if (root_vector == sacn_root_vector_extended)
+  {
+    if (framing_vector == sacn_framing_vector_sync && packet.size() >= sacn_sync_packet_size)
+    {
+      return sync(read_be16(packet, sacn_sync_address_offset));
+    }
+    return Packet::ignored;
+  }
+  if (root_vector != sacn_root_vector_data || framing_vector != sacn_framing_vector_data)
+  {
+    return Packet::ignored;
+  }
+  if (packet.size() <= sacn_start_code_offset)
+  {
+    return Packet::invalid;
+  }
+
+  // only live DMX (start code 0)
+  if ((packet[112] & sacn_option_preview) != 0 || packet[sacn_start_code_offset] != 0)
+  {
+    return Packet::ignored;
+  }
+
+  const uint16_t universe = read_be16(packet, 113);
+  // property value count includes the start code
+  const uint16_t property_count = read_be16(packet, 123);
+  const size_t length = std::min<size_t>({property_count > 0 ? property_count - 1u : 0u, packet.size() - sacn_start_code_offset - 1, dmx_max_slots});
+  return write_universe(universe, packet.subspan(sacn_start_code_offset + 1, length), read_be16(packet, sacn_data_sync_address_offset));
+}
+
+DmxDecoder::Packet DmxDecoder::sync(uint16_t sync_address)
+{
+  // sync packets for other receivers' universes are ignored
+  const auto sync_addresses_end = m_sync_addresses.begin() + m_universe_map.size();
+  if (sync_address == 0 || std::find(m_sync_addresses.begin(), sync_addresses_end, sync_address) == sync_addresses_end)
+  {
+    return Packet::ignored;
+  }
+  m_sync_mode   = true;
+  m_frame_ready = true;
+  return Packet::sync;
+}
+
+DmxDecoder::Packet DmxDecoder::write_universe(uint16_t universe, std::span<const uint8_t> slots, uint16_t sync_address)
+{
+  auto mapping = std::lower_bound(m_universe_map.begin(), m_universe_map.end(), universe,
+                                  [](const DmxUniverseMap &entry, uint16_t value) { return entry.universe < value; });
+  if (mapping == m_universe_map.end() || mapping->universe != universe)
+  {
+    return Packet::ignored;
+  }
+
+  for (; mapping != m_universe_map.end() && mapping->universe == universe; mapping++)
+  {
+    write_mapping(*mapping, slots);
+    m_sync_addresses[static_cast<size_t>(mapping - m_universe_map.begin())] = sync_address;
+  }
+
+  m_dmx_packet_count++;
+  if (!m_sync_mode || sync_address == 0)
+  {
+    m_frame_ready = true;
+  }
+  return Packet::dmx;
+}
+
+void DmxDecoder::write_mapping(const DmxUniverseMap &mapping, std::span<const uint8_t> slots)
+{
+  const size_t slots_per_led = (mapping.format == DmxSlotFormat::rgb16) ? 6 : 3;
+  const size_t chain_leds    = m_gs_bytes.size() / (colour_channels_per_led * 2);
+  if (mapping.first_slot >= slots.size() || mapping.first_led >= chain_leds)
+  {
+    return;
+  }
+  const size_t num_leds = std::min<size_t>(
+      {mapping.num_leds, (slots.size() - mapping.first_slot) / slots_per_led, chain_leds - mapping.first_led});
+
+  // byte offset of red, green and blue within each LED, for each slot position
+  std::array<size_t, 3> slot_to_byte{};
+  switch (mapping.order)
+  {
+    case DmxColourOrder::rgb:
+      slot_to_byte = {static_cast<size_t>(ColourChannel::red) * 2, static_cast<size_t>(ColourChannel::green) * 2,
+                      static_cast<size_t>(ColourChannel::blue) * 2};
+      break;
+    case DmxColourOrder::grb:
+      slot_to_byte = {static_cast<size_t>(ColourChannel::green) * 2, static_cast<size_t>(ColourChannel::red) * 2,
+                      static_cast<size_t>(ColourChannel::blue) * 2};
+      break;
+    case DmxColourOrder::bgr:
+      slot_to_byte = {static_cast<size_t>(ColourChannel::blue) * 2, static_cast<size_t>(ColourChannel::green) * 2,
+                      static_cast<size_t>(ColourChannel::red) * 2};
+      break;
+  }
+
+  const uint8_t *slot = slots.data() + mapping.first_slot;
+  uint8_t *led_bytes  = m_gs_bytes.data() + mapping.first_led * colour_channels_per_led * 2;
+  for (size_t led_idx = 0; led_idx < num_leds; led_idx++)
+  {
+    for (size_t colour_idx = 0; colour_idx < colour_channels_per_led; colour_idx++)
+    {
+      uint8_t *channel = led_bytes + slot_to_byte[colour_idx];
+      if (mapping.format == DmxSlotFormat::rgb16)
+      {
+        channel[0] = slot[colour_idx * 2];
+        channel[1] = slot[colour_idx * 2 + 1];
+      }
+      else
+      {
+        const uint16_t pwm = m_gamma[slot[colour_idx]];
+        channel[0]         = static_cast<uint8_t>(pwm >> 8);
+        channel[1]         = static_cast<uint8_t>(pwm & 0xFF);
+      }
+    }
+    slot += slots_per_led;
+    led_bytes += colour_channels_per_led * 2;
+  }
+}
+
+#if defined(__linux__)
+
+DmxUdpReceiver::DmxUdpReceiver(DmxDecoder &decoder)
+    : m_decoder(decoder)
+{
+  for (size_t idx = 0; idx < m_batch_size; idx++)
+  {
+    m_iovecs[idx].iov_base            = m_buffers[idx].data();
+    m_iovecs[idx].iov_len             = m_buffers[idx].size();
+    m_headers[idx].msg_hdr.msg_iov    = &m_iovecs[idx];
+    m_headers[idx].msg_hdr.msg_iovlen = 1;
+  }
+}
+
+bool DmxUdpReceiver::open(uint16_t port, uint32_t bind_address)
+{
+  close();
+  m_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (m_fd < 0)
+  {
+    return false;
+  }
+
+  // several receivers (e.g. a monitor) may listen on the same port
+  const int reuse = 1;
+  ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  sockaddr_in address{};
+  address.sin_family      = AF_INET;
+  address.sin_port        = htons(port);
+  address.sin_addr.s_addr = htonl(bind_address);
+  if (::bind(m_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0)
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool DmxUdpReceiver::join_sacn_universe(uint16_t universe)
+{
+  if (m_fd < 0)
+  {
+    return false;
+  }
+  ip_mreq request{};
+  request.imr_multiaddr.s_addr = htonl((239u << 24) | (255u << 16) | universe);
+  request.imr_interface.s_addr = htonl(INADDR_ANY);
+  return ::setsockopt(m_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) == 0;
+}
+
+void DmxUdpReceiver::close()
+{
+  if (m_fd >= 0)
+  {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+uint16_t DmxUdpReceiver::get_port() const
+{
+  sockaddr_in address{};
+  socklen_t length = sizeof(address);
+  if (m_fd < 0 || ::getsockname(m_fd, reinterpret_cast<sockaddr *>(&address), &length) < 0)
+  {
+    return 0;
+  }
+  return ntohs(address.sin_port);
+}
+
+int DmxUdpReceiver::receive(int timeout_ms)
+{
+  if (m_fd < 0)
+  {
+    return -1;
+  }
+
+  pollfd poll_fd{m_fd, POLLIN, 0};
+  const int ready = ::poll(&poll_fd, 1, timeout_ms);
+  if (ready <= 0)
+  {
+    return ready;
+  }
+
+  int num_decoded = 0;
+  while (true)
+  {
+    const int num_received = ::recvmmsg(m_fd, m_headers.data(), m_batch_size, MSG_DONTWAIT, nullptr);
+    if (num_received <= 0)
+    {
+      break;
+    }
+    for (int idx = 0; idx < num_received; idx++)
+    {
+      m_decoder.decode(std::span<const uint8_t>(m_buffers[idx].data(), m_headers[idx].msg_len));
+    }
+    num_decoded += num_received;
+    if (static_cast<size_t>(num_received) < m_batch_size)
+    {
+      break;
+    }
+  }
+  return num_decoded;
+}
+
+#endif // __linux__
+
+} // namespace tlc5955
@@ -0,0 +1,97 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_latch_scheduler.hpp"
+
+namespace tlc5955
+{
+
+LatchScheduler::LatchScheduler(Driver &driver, TIM_TypeDef *period_tim)
+    : m_driver(driver),
+      m_period_tim(*period_tim)
+{
+}
+
+void LatchScheduler::start()
+{
+  m_latch_pending = false;
+
+  m_period_tim.ARR  = m_display_period_gsclk - 1;
+  m_period_tim.CNT  = 0;
+  // load ARR now and clear the update flag raised by doing so
+  m_period_tim.EGR  = TIM_EGR_UG;
+  m_period_tim.SR   = ~TIM_SR_UIF;
+  m_period_tim.DIER = m_period_tim.DIER | TIM_DIER_UIE;
+  m_period_tim.CR1  = m_period_tim.CR1 | TIM_CR1_CEN;
+}
+
+void LatchScheduler::stop()
+{
+  m_period_tim.CR1  = m_period_tim.CR1 & ~TIM_CR1_CEN;
+  m_period_tim.DIER = m_period_tim.DIER & ~TIM_DIER_UIE;
+
+  m_latch_pending = false;
+}
+
+bool LatchScheduler::queue_latch()
+{
+  // GSCLKs left before the period boundary
+  const uint32_t slack = (m_display_period_gsclk - 1) - (m_period_tim.CNT % m_display_period_gsclk);
+  m_stats.last_slack   = slack;
+  if (slack < m_stats.min_slack)
+  {
+    m_stats.min_slack = slack;
+  }
+
+  // no read-modify-write atomics on Cortex-M0+. If isr() runs between the test and the store, the
+  // frame it latched is the one just shifted in, so the older frame was still dropped.
+  const bool replaced = m_latch_pending;
+  m_latch_pending     = true;
+  if (replaced)
+  {
+    m_stats.frames_dropped++;
+  }
+  return !replaced;
+}
+
+void LatchScheduler::isr()
+{
+  if ((m_period_tim.SR & TIM_SR_UIF) == 0)
+  {
+    return;
+  }
+  m_period_tim.SR = ~TIM_SR_UIF;
+
+  if (m_latch_pending)
+  {
+    m_latch_pending = false;
+    m_driver.latch();
+    m_stats.frames_latched++;
+  }
+  else
+  {
+    m_stats.idle_periods++;
+  }
+}
+
+} // namespace tlc5955
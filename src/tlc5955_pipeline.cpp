@@ -0,0 +1,58 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_pipeline.hpp"
+
+namespace tlc5955
+{
+
+PipelinedSender::PipelinedSender(Driver &driver, DMA_Channel_TypeDef *tx_dma)
+    : m_driver(driver),
+      m_tx_dma(driver, tx_dma)
+{
+}
+
+bool PipelinedSender::send_frame_store(Driver::DataLatchType latch_type, Driver::LatchPinOption latch_option)
+{
+  const std::span<const uint8_t> store = m_driver.get_frame_store();
+  if (store.empty())
+  {
+    return false;
+  }
+
+  for (size_t chip_offset = 0; chip_offset < store.size(); chip_offset += chip_frame_size_bytes)
+  {
+    m_tx_dma.wait();
+    m_driver.shift_first_bit(latch_type);
+    m_tx_dma.start(store.subspan(chip_offset).first<chip_frame_size_bytes>());
+  }
+  m_tx_dma.wait();
+
+  if (latch_option == Driver::LatchPinOption::latch_after_send)
+  {
+    m_driver.latch();
+  }
+  return true;
+}
+
+} // namespace tlc5955
@@ -0,0 +1,78 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_spi_dma.hpp"
+
+namespace tlc5955
+{
+
+SpiTxDma::SpiTxDma(Driver &driver, DMA_Channel_TypeDef *tx_dma)
+    : m_driver(driver),
+      m_tx_dma(*tx_dma)
+{
+}
+
+void SpiTxDma::start(std::span<const uint8_t, chip_frame_size_bytes> chip_bytes [[maybe_unused]])
+{
+  m_driver.m_stats.add_frame(chip_frame_size_bytes);
+  m_busy = true;
+
+#if not defined(X86_UNIT_TESTING_ONLY)
+  SPI_TypeDef &spi = m_driver.m_serial_interface.get_spi_handle();
+
+  // memory to peripheral, 8-bit both sides, increment memory
+  m_tx_dma.CCR   = 0;
+  m_tx_dma.CPAR  = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&spi.DR));
+  m_tx_dma.CMAR  = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(chip_bytes.data()));
+  m_tx_dma.CNDTR = chip_frame_size_bytes;
+  m_tx_dma.CCR   = DMA_CCR_DIR | DMA_CCR_MINC;
+  m_tx_dma.CCR   = m_tx_dma.CCR | DMA_CCR_EN;
+
+  spi.CR2 = spi.CR2 | SPI_CR2_TXDMAEN;
+#endif
+}
+
+void SpiTxDma::wait()
+{
+  if (!m_busy)
+  {
+    return;
+  }
+
+  [[maybe_unused]] const uint32_t send_start = m_driver.m_stats.start();
+#if not defined(X86_UNIT_TESTING_ONLY)
+  while (m_tx_dma.CNDTR != 0)
+  {
+  }
+  m_tx_dma.CCR = m_tx_dma.CCR & ~DMA_CCR_EN;
+
+  SPI_TypeDef &spi = m_driver.m_serial_interface.get_spi_handle();
+  spi.CR2          = spi.CR2 & ~SPI_CR2_TXDMAEN;
+  m_driver.spi_wait_idle();
+#endif
+  m_driver.m_stats.add_send_ticks(send_start);
+
+  m_busy = false;
+}
+
+} // namespace tlc5955
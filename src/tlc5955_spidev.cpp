@@ -0,0 +1,198 @@
+// MIT License
+
+// Copyright (c) 2022 Chris Sutton
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "tlc5955_spidev.hpp"
+
+#if defined(__linux__)
+
+  #include <algorithm>
+  #include <cstring>
+  #include <fcntl.h>
+  #include <linux/gpio.h>
+  #include <sys/ioctl.h>
+  #include <unistd.h>
+
+namespace tlc5955
+{
+
+bool pack_chain_bitstream(std::span<const uint8_t> chain_bytes, bool control_data, std::span<uint8_t> bitstream)
+{
+  if ((chain_bytes.size() % chip_frame_size_bytes) != 0)
+  {
+    return false;
+  }
+  const size_t num_chips = chain_bytes.size() / chip_frame_size_bytes;
+  if (bitstream.size() != chain_bitstream_size_bytes(num_chips))
+  {
+    return false;
+  }
+
+  std::fill(bitstream.begin(), bitstream.end(), 0);
+
+  // leading zeros shift out of the far end of the chain
+  size_t bit_pos = bitstream.size() * 8 - num_chips * chip_frame_size_bits;
+  for (size_t chip_idx = 0; chip_idx < num_chips; chip_idx++)
+  {
+    if (control_data)
+    {
+      bitstream[bit_pos / 8] = static_cast<uint8_t>(bitstream[bit_pos / 8] | (0x80 >> (bit_pos % 8)));
+    }
+    bit_pos++;
+
+    const uint8_t shift = static_cast<uint8_t>(bit_pos % 8);
+    for (const uint8_t byte : chain_bytes.subspan(chip_idx * chip_frame_size_bytes, chip_frame_size_bytes))
+    {
+      bitstream[bit_pos / 8] = static_cast<uint8_t>(bitstream[bit_pos / 8] | (byte >> shift));
+      if (shift != 0)
+      {
+        bitstream[bit_pos / 8 + 1] = static_cast<uint8_t>(byte << (8 - shift));
+      }
+      bit_pos += 8;
+    }
+  }
+  return true;
+}
+
+int LinuxIo::open(const char *path, int flags) { return ::open(path, flags); }
+
+int LinuxIo::close(int fd) { return ::close(fd); }
+
+int LinuxIo::ioctl(int fd, unsigned long request, void *arg) { return ::ioctl(fd, request, arg); }
+
+SpidevPort::SpidevPort(LinuxIo &io, const SpidevConfig &config)
+    : m_io(io),
+      m_config(config)
+{
+}
+
+bool SpidevPort::open()
+{
+  m_spi_fd = m_io.open(m_config.spi_device, O_RDWR);
+  if (m_spi_fd < 0)
+  {
+    return false;
+  }
+
+  uint8_t mode          = SPI_MODE_0;
+  uint8_t bits_per_word = 8;
+  uint32_t speed_hz     = m_config.speed_hz;
+  if (m_io.ioctl(m_spi_fd, SPI_IOC_WR_MODE, &mode) < 0 || m_io.ioctl(m_spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits_per_word) < 0 ||
+      m_io.ioctl(m_spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz) < 0)
+  {
+    close();
+    return false;
+  }
+
+  const int chip_fd = m_io.open(m_config.gpio_chip, O_RDWR);
+  if (chip_fd < 0)
+  {
+    close();
+    return false;
+  }
+
+  gpio_v2_line_request request{};
+  request.offsets[0]   = m_config.lat_line;
+  request.num_lines    = 1;
+  request.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+  std::strncpy(request.consumer, "tlc5955_lat", sizeof(request.consumer) - 1);
+  const int result = m_io.ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &request);
+  // the line request fd stays valid after the chip is closed
+  m_io.close(chip_fd);
+  if (result < 0)
+  {
+    close();
+    return false;
+  }
+  m_lat_fd = request.fd;
+
+  return set_lat(false);
+}
+
+void SpidevPort::close()
+{
+  if (m_lat_fd >= 0)
+  {
+    m_io.close(m_lat_fd);
+    m_lat_fd = -1;
+  }
+  if (m_spi_fd >= 0)
+  {
+    m_io.close(m_spi_fd);
+    m_spi_fd = -1;
+  }
+}
+
+bool SpidevPort::transfer(std::span<const uint8_t> bytes)
+{
+  if (m_spi_fd < 0 || m_config.max_transfer_bytes == 0 || m_config.max_message_bytes == 0)
+  {
+    return false;
+  }
+
+  size_t offset = 0;
+  while (offset < bytes.size())
+  {
+    // fill one message
+    size_t num_transfers = 0;
+    size_t message_bytes = 0;
+    while (offset < bytes.size() && num_transfers < m_max_transfers_per_message && message_bytes < m_config.max_message_bytes)
+    {
+      const size_t len = std::min({bytes.size() - offset, m_config.max_transfer_bytes, m_config.max_message_bytes - message_bytes});
+      m_transfers[num_transfers]        = spi_ioc_transfer{};
+      m_transfers[num_transfers].tx_buf = reinterpret_cast<uintptr_t>(bytes.data() + offset);
+      m_transfers[num_transfers].len    = static_cast<uint32_t>(len);
+      offset += len;
+      message_bytes += len;
+      num_transfers++;
+    }
+
+    // SPI_IOC_MESSAGE(n) without the variable length array
+    const unsigned long request = _IOC(_IOC_WRITE, SPI_IOC_MAGIC, 0, num_transfers * sizeof(spi_ioc_transfer));
+    if (m_io.ioctl(m_spi_fd, request, m_transfers.data()) < 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SpidevPort::latch()
+{
+  if (m_lat_fd < 0)
+  {
+    return false;
+  }
+  return set_lat(true) && set_lat(false);
+}
+
+bool SpidevPort::set_lat(bool level)
+{
+  gpio_v2_line_values values{};
+  values.mask = 1;
+  values.bits = level ? 1 : 0;
+  return m_io.ioctl(m_lat_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) >= 0;
+}
+
+} // namespace tlc5955
+
+#endif // __linux__
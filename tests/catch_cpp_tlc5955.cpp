@@ -25,10 +25,68 @@
 #include <iostream>
 // #include <tlc5955_tester.hpp>
 #include <tlc5955.hpp>
+#include <tlc5955_animation.hpp>
+#include <tlc5955_bus_scheduler.hpp>
+#include <tlc5955_chain_control.hpp>
+#include <tlc5955_chain_renderer.hpp>
+#include <tlc5955_colour_correction.hpp>
+#include <tlc5955_command_buffer.hpp>
+#include <tlc5955_compositor.hpp>
+#include <tlc5955_crossfade.hpp>
+#include <tlc5955_dmx.hpp>
+#include <tlc5955_faults.hpp>
+#include <tlc5955_latch_scheduler.hpp>
+#include <tlc5955_multi_bus.hpp>
+#include <tlc5955_patterns.hpp>
+#include <tlc5955_pipeline.hpp>
+#include <tlc5955_pool.hpp>
+#include <tlc5955_power.hpp>
+#include <tlc5955_shared_frame.hpp>
+#include <tlc5955_snapshot.hpp>
+#include <tlc5955_spidev.hpp>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <linux/gpio.h>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+#include <vector>
 
 // TLC5955 device datasheet:
 // https://www.ti.com/lit/ds/symlink/tlc5955.pdf
 
+// exposes the packed common register
+class CommonRegisterDriver : public tlc5955::Driver
+{
+public:
+    using tlc5955::Driver::Driver;
+    std::span<const uint8_t> common_bytes()
+    {
+        noarch::bit_manip::bitset_to_bytearray(m_common_byte_register, m_common_bit_register);
+        return m_common_byte_register;
+    }
+};
+
+// @brief The SPI2/GPIOB/TIM4 wiring shared by the tests, with the RCC instance that is usually present on STM32.
+// The RCC is a single static instance, so tests do not leak one each.
+// @param spi The SPI peripheral
+// @param lat_pin The latch pin on GPIOB
+static tlc5955::DriverSerialInterface make_spi_interface(SPI_TypeDef *spi = SPI2, uint16_t lat_pin = GPIO_BSRR_BS9)
+{
+    static RCC_TypeDef rcc;
+    RCC = &rcc;
+    return tlc5955::DriverSerialInterface(
+        spi,
+        std::make_pair(GPIOB, lat_pin),         // latch port+pin
+        std::make_pair(GPIOB, GPIO_BSRR_BS7),   // mosi port+pin
+        std::make_pair(GPIOB, GPIO_BSRR_BS8),   // sck port+pin
+        std::make_pair(TIM4, TIM_CCER_CC1E),    // gsclk timer+channel
+        RCC_IOPENR_GPIOBEN,                     // for enabling GPIOB clock
+        RCC_APBENR1_SPI2EN                      // for enabling SPI2 clock
+    );
+}
+
 TEST_CASE("Testing TLC5955 common register", "[tlc5955]")
 {
     // create the RCC instance that is usually present when running on STM32
@@ -50,6 +108,168 @@ TEST_CASE("Testing TLC5955 common register", "[tlc5955]")
     REQUIRE(true);
 }
 
+TEST_CASE("Testing TLC5955 instrumentation counters", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+
+    tlc5955::Driver d(tlc5955_spi_interface);
+
+    SECTION("init sends two control frames and one latch")
+    {
+        d.init();
+        tlc5955::DriverStats stats = d.get_stats();
+        REQUIRE(stats.frames_sent == 2);
+        REQUIRE(stats.bytes_sent == 192);
+        REQUIRE(stats.control_frames == 2);
+        REQUIRE(stats.data_frames == 0);
+        REQUIRE(stats.latch_pulses == 1);
+    }
+
+    SECTION("data frames and reset")
+    {
+        d.send_first_bit(tlc5955::Driver::DataLatchType::data);
+        d.send_spi_bytes(tlc5955::Driver::LatchPinOption::no_latch);
+        d.send_first_bit(tlc5955::Driver::DataLatchType::data);
+        d.send_spi_bytes(tlc5955::Driver::LatchPinOption::latch_after_send);
+        REQUIRE(d.get_stats().data_frames == 2);
+        REQUIRE(d.get_stats().latch_pulses == 1);
+
+        // the host times the same phases with std::chrono
+        REQUIRE(d.get_stats().first_bit_ticks > 0);
+        REQUIRE(d.get_stats().packing_ticks > 0);
+        REQUIRE(d.get_stats().send_ticks > 0);
+
+        d.reset_stats();
+        REQUIRE(d.get_stats().frames_sent == 0);
+        REQUIRE(d.get_stats().data_frames == 0);
+        REQUIRE(d.get_stats().send_ticks == 0);
+    }
+}
+
+TEST_CASE("Testing TLC5955 packed half word SPI writes", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+    tlc5955::Driver d(tlc5955_spi_interface);
+
+    REQUIRE(d.get_spi_frame_mode() == tlc5955::Driver::SpiFrameMode::byte_frames);
+    d.set_spi_frame_mode(tlc5955::Driver::SpiFrameMode::packed_half_words);
+    REQUIRE(d.get_spi_frame_mode() == tlc5955::Driver::SpiFrameMode::packed_half_words);
+
+    // the 8-bit FIFO sends the low byte of each write first, so a GS channel must still go out MSB first
+    static tlc5955::GreyscaleFrame<1> frame;
+    frame.set_channel(0, 0, 0xABCD);
+    frame.set_channel(0, 1, 0x0102);
+    const auto bytes = frame.data();
+    for (size_t byte_idx = 0; byte_idx < 4; byte_idx += 2)
+    {
+        const uint16_t half_word = tlc5955::Driver::spi_half_word(bytes[byte_idx], bytes[byte_idx + 1]);
+        REQUIRE((half_word & 0xFF) == bytes[byte_idx]);
+        REQUIRE((half_word >> 8) == bytes[byte_idx + 1]);
+    }
+    static_assert(tlc5955::Driver::spi_half_word(0xAB, 0xCD) == 0xCDAB);
+    REQUIRE(tlc5955::Driver::spi_half_word(bytes[2], bytes[3]) == 0x0201);
+}
+
+TEST_CASE("Testing TLC5955 control data shadow", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+    tlc5955::Driver d(tlc5955_spi_interface);
+
+    REQUIRE_FALSE(d.has_control());
+    tlc5955::Driver::ControlData control{};
+    REQUIRE(d.update_control(control, 3));
+    REQUIRE(d.has_control());
+    REQUIRE(d.get_stats().control_frames == 6);
+    REQUIRE(d.get_stats().latch_pulses == 2);
+
+    // unchanged
+    REQUIRE_FALSE(d.update_control(control, 3));
+    REQUIRE(d.get_stats().control_frames == 6);
+    REQUIRE(d.get_stats().control_writes_skipped == 1);
+
+    control.global_brightness[1] = 0x7F;
+    REQUIRE(d.update_control(control, 3));
+    REQUIRE(d.get_stats().control_frames == 12);
+    REQUIRE(d.get_control().global_brightness[1] == 0x7F);
+
+    // the control image is packed on the side, so staged GS data survives
+    CommonRegisterDriver staged(tlc5955_spi_interface);
+    staged.set_greyscale_cmd_rgb_at_position(3, 0xFFFF, 0x1234, 0);
+    std::array<uint8_t, tlc5955::chip_frame_size_bytes> staged_bytes{};
+    std::copy_n(staged.common_bytes().begin(), staged_bytes.size(), staged_bytes.begin());
+    REQUIRE(std::any_of(staged_bytes.begin(), staged_bytes.end(), [](uint8_t byte) { return byte != 0; }));
+    REQUIRE(staged.update_control(control, 1));
+    REQUIRE(std::equal(staged_bytes.begin(), staged_bytes.end(), staged.common_bytes().begin()));
+
+    // and matches the common register layout
+    staged.clear_register();
+    staged.set_ctrl_cmd();
+    staged.set_padding_bits();
+    staged.set_function_cmd(control.display, control.timing, control.refresh, control.pwm, control.short_detect);
+    staged.set_global_brightness_cmd(control.global_brightness[0], control.global_brightness[1], control.global_brightness[2]);
+    staged.set_max_current_cmd(control.max_current[0], control.max_current[1], control.max_current[2]);
+    staged.set_dot_correction_cmd_all(control.dot_correction);
+    std::array<uint8_t, tlc5955::chip_frame_size_bytes> control_bytes{};
+    tlc5955::Driver::pack_control(control, control_bytes);
+    REQUIRE(std::equal(control_bytes.begin(), control_bytes.end(), staged.common_bytes().begin()));
+
+    // init() only latches once, so the same control data is still sent with both latches
+    d.init();
+    REQUIRE_FALSE(d.has_control());
+    REQUIRE(d.get_control() == tlc5955::Driver::ControlData{});
+    REQUIRE(d.update_control(tlc5955::Driver::ControlData{}, 3));
+    REQUIRE_FALSE(d.update_control(tlc5955::Driver::ControlData{}, 3));
+    d.invalidate_control();
+    REQUIRE(d.update_control(tlc5955::Driver::ControlData{}, 3));
+    REQUIRE_FALSE(d.update_control(tlc5955::Driver::ControlData{}, 0));
+}
+
+TEST_CASE("Testing TLC5955 GSCLK synchronised latch", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+
+    tlc5955::Driver d(tlc5955_spi_interface);
+    TIM3 = new TIM_TypeDef;
+    tlc5955::LatchScheduler scheduler(d, TIM3);
+    scheduler.start();
+    REQUIRE(TIM3->ARR == 65535);
+    REQUIRE(scheduler.ready());
+
+    // frame queued with 1000 GSCLKs to go
+    TIM3->CNT = 64535;
+    REQUIRE(scheduler.queue_latch());
+    REQUIRE_FALSE(scheduler.ready());
+    REQUIRE(scheduler.get_stats().last_slack == 1000);
+
+    // no update event yet: nothing latched
+    scheduler.isr();
+    REQUIRE(d.get_stats().latch_pulses == 0);
+
+    // period boundary latches the frame
+    TIM3->SR = TIM_SR_UIF;
+    scheduler.isr();
+    REQUIRE(d.get_stats().latch_pulses == 1);
+    REQUIRE(scheduler.ready());
+
+    // second frame replaced before the boundary
+    TIM3->CNT = 65000;
+    REQUIRE(scheduler.queue_latch());
+    REQUIRE_FALSE(scheduler.queue_latch());
+    TIM3->SR = TIM_SR_UIF;
+    scheduler.isr();
+
+    // idle period
+    TIM3->SR = TIM_SR_UIF;
+    scheduler.isr();
+
+    tlc5955::LatchSchedulerStats stats = scheduler.get_stats();
+    REQUIRE(stats.frames_latched == 2);
+    REQUIRE(stats.frames_dropped == 1);
+    REQUIRE(stats.idle_periods == 1);
+    REQUIRE(stats.min_slack == 535);
+    REQUIRE(d.get_stats().latch_pulses == 2);
+}
+
 
 // TEST_CASE("Testing TLC5955 common register", "[tlc5955]")
 // {
@@ -955,4 +1175,1431 @@ TEST_CASE("Testing TLC5955 common register", "[tlc5955]")
 //     }        
 
 
-// }
\ No newline at end of file
+// }
+TEST_CASE("Testing TLC5955 GSCLK timer configuration", "[tlc5955]")
+{
+    SECTION("refresh rate calculation")
+    {
+        // 64MHz / 9 = 7.11MHz GSCLK, 108.5Hz refresh
+        tlc5955::GsclkTiming timing = tlc5955::calculate_gsclk_timing(64000000, 100, tlc5955::gsclk_per_period_normal_pwm);
+        REQUIRE(timing.prescaler == 0);
+        REQUIRE(timing.auto_reload == 8);
+        REQUIRE(timing.compare == 4);
+        REQUIRE(timing.gsclk_hz == 7111111);
+        REQUIRE(timing.refresh_millihz == 108506);
+
+        // slowest refresh rate
+        timing = tlc5955::calculate_gsclk_timing(64000000, 1, tlc5955::gsclk_per_period_normal_pwm);
+        REQUIRE(timing.prescaler == 0);
+        REQUIRE(timing.auto_reload == 975);
+        REQUIRE(timing.refresh_millihz >= 1000);
+
+        // limited by the TLC5955 max GSCLK
+        timing = tlc5955::calculate_gsclk_timing(128000000, 1000, tlc5955::gsclk_per_period_normal_pwm);
+        REQUIRE(timing.gsclk_hz <= tlc5955::gsclk_max_hz);
+        REQUIRE(timing.auto_reload == 3);
+
+        // invalid input
+        timing = tlc5955::calculate_gsclk_timing(64000000, 0, tlc5955::gsclk_per_period_normal_pwm);
+        REQUIRE(timing.gsclk_hz == 0);
+    }
+
+    SECTION("timer registers")
+    {
+        TIM4 = new TIM_TypeDef;
+        tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+
+        tlc5955::Driver d(tlc5955_spi_interface);
+        // ES-PWM: 64MHz / 2 = 32MHz GSCLK, 62.5KHz refresh
+        tlc5955::GsclkTiming timing = d.configure_gsclk(64000000, 60000, tlc5955::Driver::PwmFunction::enhanced_pwm);
+        REQUIRE(timing.refresh_millihz == 62500000);
+        REQUIRE(TIM4->PSC == 0);
+        REQUIRE(TIM4->ARR == 1);
+        REQUIRE(TIM4->CCR1 == 1);
+        REQUIRE((TIM4->CCMR1 & TIM_CCMR1_OC1M) == (6U << TIM_CCMR1_OC1M_Pos));
+    }
+}
+
+TEST_CASE("Testing TLC5955 packed greyscale frame", "[tlc5955]")
+{
+    static tlc5955::GreyscaleFrame<2> frame;
+    frame.clear();
+
+    // LED17 is LED1 of chip 1: channels 3 (blue), 4 (green), 5 (red)
+    REQUIRE(frame.set_rgb(17, 0x1234, 0x5678, 0x9ABC));
+    REQUIRE(frame.chip(1)[6] == 0x9A);
+    REQUIRE(frame.chip(1)[7] == 0xBC);
+    REQUIRE(frame.chip(1)[8] == 0x56);
+    REQUIRE(frame.chip(1)[9] == 0x78);
+    REQUIRE(frame.chip(1)[10] == 0x12);
+    REQUIRE(frame.chip(1)[11] == 0x34);
+    REQUIRE(frame.get_colour(17, tlc5955::ColourChannel::red) == 0x1234);
+    REQUIRE(frame.get_channel(1, 4) == 0x5678);
+    REQUIRE(frame.data()[96 + 10] == 0x12);
+
+    // out of range
+    REQUIRE_FALSE(frame.set_rgb(32, 0, 0, 0));
+    REQUIRE_FALSE(frame.set_channel(0, 48, 0));
+    REQUIRE_FALSE(frame.set_channel(2, 0, 0));
+}
+
+TEST_CASE("Testing TLC5955 multiple SPI buses", "[tlc5955]")
+{
+    SPI1 = new SPI_TypeDef;
+    SPI2 = new SPI_TypeDef;
+
+    tlc5955::DriverSerialInterface bus0_interface = make_spi_interface(SPI1);
+    tlc5955::DriverSerialInterface bus1_interface = make_spi_interface(SPI2);
+
+    tlc5955::Driver bus0(bus0_interface);
+    tlc5955::Driver bus1(bus1_interface);
+    static DMA_Channel_TypeDef bus0_tx_dma;
+    static DMA_Channel_TypeDef bus1_tx_dma;
+
+    using multi_bus_t = tlc5955::MultiBusDriver<2, 3>;
+    auto multi_bus_ptr = std::make_unique<multi_bus_t>(std::array<tlc5955::Driver *, 2>{&bus0, &bus1},
+                                                       std::array<DMA_Channel_TypeDef *, 2>{&bus0_tx_dma, &bus1_tx_dma},
+                                                       multi_bus_t::LatchMode::shared);
+    auto &multi_bus = *multi_bus_ptr;
+
+    // LED48 is the first LED of the second bus, red is channel 2
+    REQUIRE(multi_bus.set_greyscale_cmd_rgb_at_position(48, 0xFFFF, 0, 0));
+    REQUIRE(multi_bus.frame().chip(3)[4] == 0xFF);
+    REQUIRE_FALSE(multi_bus.set_greyscale_cmd_rgb_at_position(96, 0xFFFF, 0, 0));
+
+    multi_bus.send_frame(tlc5955::Driver::LatchPinOption::latch_after_send);
+    REQUIRE(bus0.get_stats().frames_sent == 3);
+    REQUIRE(bus0.get_stats().bytes_sent == 288);
+    REQUIRE(bus0.get_stats().data_frames == 3);
+    REQUIRE(bus1.get_stats().frames_sent == 3);
+    REQUIRE(bus1.get_stats().data_frames == 3);
+
+    // shared LAT: only the first bus pulses it
+    REQUIRE(bus0.get_stats().latch_pulses == 1);
+    REQUIRE(bus1.get_stats().latch_pulses == 0);
+
+    // per-bus LAT on one port: both lines go in a single write per edge
+    multi_bus_t per_bus_latch({&bus0, &bus1}, {&bus0_tx_dma, &bus1_tx_dma}, multi_bus_t::LatchMode::per_bus);
+    REQUIRE(per_bus_latch.get_num_lat_ports() == 1);
+    per_bus_latch.latch();
+    REQUIRE(bus0.get_stats().latch_pulses == 2);
+    REQUIRE(bus1.get_stats().latch_pulses == 1);
+}
+
+TEST_CASE("Testing TLC5955 pipelined send", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+
+    tlc5955::Driver d(tlc5955_spi_interface);
+    static DMA_Channel_TypeDef tx_dma;
+    tlc5955::PipelinedSender sender(d, &tx_dma);
+
+    SECTION("pack callback")
+    {
+        std::array<size_t, 4> packed_order{};
+        size_t num_packed{0};
+        sender.send(
+            4,
+            [&](size_t chip_idx, std::span<uint8_t, tlc5955::chip_frame_size_bytes> out) {
+                packed_order[num_packed++] = chip_idx;
+                out[0] = static_cast<uint8_t>(chip_idx);
+            },
+            tlc5955::Driver::DataLatchType::data,
+            tlc5955::Driver::LatchPinOption::latch_after_send);
+
+        REQUIRE(num_packed == 4);
+        REQUIRE(packed_order == std::array<size_t, 4>{0, 1, 2, 3});
+        REQUIRE(d.get_stats().frames_sent == 4);
+        REQUIRE(d.get_stats().data_frames == 4);
+        REQUIRE(d.get_stats().latch_pulses == 1);
+    }
+
+    SECTION("greyscale frame")
+    {
+        static tlc5955::GreyscaleFrame<3> frame;
+        sender.send(frame, tlc5955::Driver::LatchPinOption::no_latch);
+        REQUIRE(d.get_stats().frames_sent == 3);
+        REQUIRE(d.get_stats().bytes_sent == 288);
+        REQUIRE(d.get_stats().latch_pulses == 0);
+    }
+
+    SECTION("external frame store")
+    {
+        REQUIRE(d.get_frame_store().empty());
+        REQUIRE_FALSE(d.send_frame_store(tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::latch_after_send));
+        REQUIRE_FALSE(sender.send_frame_store(tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::no_latch));
+
+        // the renderer writes the store in place
+        static tlc5955::GreyscaleFrame<2> frame;
+        d.set_frame_store(frame);
+        frame.set_rgb(17, 1, 2, 3);
+        REQUIRE(d.get_frame_store().data() == frame.data().data());
+        REQUIRE(d.get_frame_store()[17 * 6 + 5] == 1);
+        REQUIRE(d.send_frame_store(tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::latch_after_send));
+        REQUIRE(sender.send_frame_store(tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::latch_after_send));
+        REQUIRE(d.get_stats().frames_sent == 4);
+        REQUIRE(d.get_stats().latch_pulses == 2);
+
+        alignas(tlc5955::frame_store_alignment) static std::array<uint8_t, 2 * 96 + 4> raw{};
+        REQUIRE(d.set_frame_store(std::span<uint8_t, 192>(raw.data(), 192)));
+        REQUIRE(d.get_frame_store().size() == 192);
+        REQUIRE_FALSE(d.set_frame_store(std::span<uint8_t, 96>(raw.data() + 1, 96)));
+        d.clear_frame_store();
+        REQUIRE(d.get_frame_store().empty());
+    }
+}
+
+// records the system calls made by tlc5955::SpidevPort
+class FakeSpidev : public tlc5955::LinuxIo
+{
+public:
+    int open(const char *path, int) override { return (std::string(path) == "/dev/gpiochip0") ? 4 : 3; }
+    int close(int) override { return 0; }
+    int ioctl(int fd, unsigned long request, void *arg) override
+    {
+        num_ioctls++;
+        if (request == GPIO_V2_GET_LINE_IOCTL)
+        {
+            static_cast<gpio_v2_line_request *>(arg)->fd = 5;
+        }
+        else if (request == GPIO_V2_LINE_SET_VALUES_IOCTL)
+        {
+            lat_levels.push_back(static_cast<gpio_v2_line_values *>(arg)->bits);
+        }
+        else if (fd == 3 && _IOC_TYPE(request) == SPI_IOC_MAGIC && _IOC_NR(request) == 0)
+        {
+            num_messages++;
+            auto *transfers = static_cast<spi_ioc_transfer *>(arg);
+            for (size_t idx = 0; idx < _IOC_SIZE(request) / sizeof(spi_ioc_transfer); idx++)
+            {
+                const auto *tx = reinterpret_cast<const uint8_t *>(transfers[idx].tx_buf);
+                sent.insert(sent.end(), tx, tx + transfers[idx].len);
+            }
+        }
+        return 0;
+    }
+
+    size_t num_ioctls{0};
+    size_t num_messages{0};
+    std::vector<uint8_t> sent;
+    std::vector<uint64_t> lat_levels;
+};
+
+TEST_CASE("Testing TLC5955 Linux spidev transport", "[tlc5955]")
+{
+    SECTION("bitstream packing")
+    {
+        static tlc5955::GreyscaleFrame<2> frame;
+        frame.clear();
+        frame.set_channel(0, 0, 0xFF00);
+        frame.set_channel(1, 0, 0xFF00);
+
+        // 2 x 769 bits = 1538 bits, front-padded by 6 bits to 193 bytes
+        std::array<uint8_t, tlc5955::chain_bitstream_size_bytes(2)> bitstream{};
+        REQUIRE(bitstream.size() == 193);
+        REQUIRE(tlc5955::pack_chain_bitstream(frame.data(), true, bitstream));
+        // 6 padding bits, control bit, then 0xFF of chip 0
+        REQUIRE(bitstream[0] == 0b00000011);
+        REQUIRE(bitstream[1] == 0b11111110);
+        REQUIRE(bitstream[2] == 0b00000000);
+        // chip 1 control bit at bit 775, then 0xFF
+        REQUIRE(bitstream[96] == 0b00000001);
+        REQUIRE(bitstream[97] == 0b11111111);
+        REQUIRE(bitstream[98] == 0b00000000);
+
+        REQUIRE_FALSE(tlc5955::pack_chain_bitstream(std::span<const uint8_t>(frame.data()).first(95), true, bitstream));
+    }
+
+    SECTION("syscalls per frame")
+    {
+        FakeSpidev fake;
+        tlc5955::SpidevConfig config;
+        config.max_transfer_bytes = 100;
+        tlc5955::SpidevPort port(fake, config);
+        REQUIRE(port.open());
+        fake.num_ioctls = 0;
+
+        static tlc5955::GreyscaleFrame<16> frame;
+        frame.fill_rgb(0xFFFF, 0, 0);
+        // bound to this section's port, too big for the stack
+        auto transport = std::make_unique<tlc5955::SpidevTransport<16>>(port);
+        REQUIRE(transport->send(frame, true));
+
+        // one SPI message with 16 transfers plus two LAT ioctls
+        REQUIRE(fake.num_messages == 1);
+        REQUIRE(fake.num_ioctls == 3);
+        REQUIRE(fake.sent.size() == tlc5955::chain_bitstream_size_bytes(16));
+        REQUIRE(fake.lat_levels == std::vector<uint64_t>{0, 1, 0});
+    }
+}
+
+// Art-Net ArtDmx packet with the given slots
+std::vector<uint8_t> make_artdmx(uint16_t universe, const std::vector<uint8_t> &slots)
+{
+    std::vector<uint8_t> packet{'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x50, 0, 14, 0, 0};
+    packet.push_back(static_cast<uint8_t>(universe & 0xFF));
+    packet.push_back(static_cast<uint8_t>(universe >> 8));
+    packet.push_back(static_cast<uint8_t>(slots.size() >> 8));
+    packet.push_back(static_cast<uint8_t>(slots.size() & 0xFF));
+    packet.insert(packet.end(), slots.begin(), slots.end());
+    return packet;
+}
+
+// E1.31 data packet with the given slots, synchronized to sync_address (0 if not synchronized)
+std::vector<uint8_t> make_sacn(uint16_t universe, const std::vector<uint8_t> &slots, uint16_t sync_address = 0)
+{
+    std::vector<uint8_t> packet(126, 0);
+    const std::array<uint8_t, 12> acn_id{'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    std::copy(acn_id.begin(), acn_id.end(), packet.begin() + 4);
+    packet[1] = 0x10;
+    packet[21] = 0x04;
+    packet[43] = 0x02;
+    packet[109] = static_cast<uint8_t>(sync_address >> 8);
+    packet[110] = static_cast<uint8_t>(sync_address & 0xFF);
+    packet[113] = static_cast<uint8_t>(universe >> 8);
+    packet[114] = static_cast<uint8_t>(universe & 0xFF);
+    packet[117] = 0x02;
+    packet[118] = 0xA1;
+    packet[122] = 0x01;
+    packet[123] = static_cast<uint8_t>((slots.size() + 1) >> 8);
+    packet[124] = static_cast<uint8_t>((slots.size() + 1) & 0xFF);
+    packet.insert(packet.end(), slots.begin(), slots.end());
+    return packet;
+}
+
+// E1.31 universe sync packet
+std::vector<uint8_t> make_sacn_sync(uint16_t sync_address)
+{
+    std::vector<uint8_t> packet(49, 0);
+    const std::array<uint8_t, 12> acn_id{'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+    std::copy(acn_id.begin(), acn_id.end(), packet.begin() + 4);
+    packet[1] = 0x10;
+    packet[21] = 0x08;
+    packet[43] = 0x01;
+    packet[45] = static_cast<uint8_t>(sync_address >> 8);
+    packet[46] = static_cast<uint8_t>(sync_address & 0xFF);
+    return packet;
+}
+
+TEST_CASE("Testing TLC5955 DMX receiver", "[tlc5955]")
+{
+    static tlc5955::GreyscaleFrame<2> frame;
+    frame.clear();
+    const std::array<tlc5955::DmxUniverseMap, 3> universe_map{{
+        // universe 1: LEDs 0-1, 8-bit RGB
+        {1, 0, 0, 2, tlc5955::DmxSlotFormat::rgb8, tlc5955::DmxColourOrder::rgb},
+        // universe 1: slots 6+ to LED 20, 8-bit GRB
+        {1, 6, 20, 1, tlc5955::DmxSlotFormat::rgb8, tlc5955::DmxColourOrder::grb},
+        // universe 2: LED 31, 16-bit RGB
+        {2, 0, 31, 1, tlc5955::DmxSlotFormat::rgb16, tlc5955::DmxColourOrder::rgb},
+    }};
+    tlc5955::DmxDecoder decoder(frame.data(), universe_map, tlc5955::gamma_table_linear);
+
+    SECTION("Art-Net")
+    {
+        using Packet = tlc5955::DmxDecoder::Packet;
+        auto packet = make_artdmx(1, {0xFF, 0x00, 0x80, 0x01, 0x02, 0x03, 0x10, 0x20, 0x30});
+        REQUIRE(decoder.decode(packet) == Packet::dmx);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::green) == 0x0000);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::blue) == 0x8080);
+        REQUIRE(frame.get_colour(1, tlc5955::ColourChannel::blue) == 0x0303);
+        REQUIRE(frame.get_colour(20, tlc5955::ColourChannel::green) == 0x1010);
+        REQUIRE(frame.get_colour(20, tlc5955::ColourChannel::red) == 0x2020);
+        // no sync seen yet: every packet is a frame
+        REQUIRE(decoder.take_frame_ready());
+        REQUIRE_FALSE(decoder.take_frame_ready());
+
+        // unmapped universe
+        REQUIRE(decoder.decode(make_artdmx(3, {0xFF})) == Packet::ignored);
+        REQUIRE(decoder.decode(std::vector<uint8_t>{'A', 'r', 't'}) == Packet::invalid);
+
+        // ArtSync switches to latching on sync only
+        const std::vector<uint8_t> art_sync{'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x52, 0, 14, 0, 0};
+        REQUIRE(decoder.decode(art_sync) == Packet::sync);
+        REQUIRE(decoder.take_frame_ready());
+        REQUIRE(decoder.decode(packet) == Packet::dmx);
+        REQUIRE_FALSE(decoder.take_frame_ready());
+    }
+
+    SECTION("sACN")
+    {
+        REQUIRE(decoder.decode(make_sacn(2, {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC})) == tlc5955::DmxDecoder::Packet::dmx);
+        REQUIRE(frame.get_colour(31, tlc5955::ColourChannel::red) == 0x1234);
+        REQUIRE(frame.get_colour(31, tlc5955::ColourChannel::green) == 0x5678);
+        REQUIRE(frame.get_colour(31, tlc5955::ColourChannel::blue) == 0x9ABC);
+        REQUIRE(decoder.get_dmx_packet_count() == 1);
+    }
+
+    SECTION("sACN sync addresses")
+    {
+        using Packet = tlc5955::DmxDecoder::Packet;
+        REQUIRE(decoder.decode(make_sacn(1, {0xFF, 0xFF, 0xFF}, 7000)) == Packet::dmx);
+        REQUIRE(decoder.decode(make_sacn(2, {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC}, 7000)) == Packet::dmx);
+        REQUIRE(decoder.take_frame_ready());
+
+        // a sync for another receiver's universes, and ArtSync with no Art-Net universes
+        REQUIRE(decoder.decode(make_sacn_sync(7001)) == Packet::ignored);
+        const std::vector<uint8_t> art_sync{'A', 'r', 't', '-', 'N', 'e', 't', 0, 0x00, 0x52, 0, 14, 0, 0};
+        REQUIRE(decoder.decode(art_sync) == Packet::ignored);
+        REQUIRE_FALSE(decoder.take_frame_ready());
+
+        REQUIRE(decoder.decode(make_sacn_sync(7000)) == Packet::sync);
+        REQUIRE(decoder.take_frame_ready());
+        REQUIRE(decoder.decode(make_sacn(2, {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC}, 7000)) == Packet::dmx);
+        REQUIRE_FALSE(decoder.take_frame_ready());
+        REQUIRE(decoder.decode(make_sacn_sync(7001)) == Packet::ignored);
+        REQUIRE_FALSE(decoder.take_frame_ready());
+        REQUIRE(decoder.decode(make_sacn_sync(7000)) == Packet::sync);
+        REQUIRE(decoder.take_frame_ready());
+
+        // universe 2 moves to another sync address, universe 1 is still synced to 7000
+        REQUIRE(decoder.decode(make_sacn(2, {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC}, 7001)) == Packet::dmx);
+        REQUIRE(decoder.decode(make_sacn_sync(7001)) == Packet::sync);
+        REQUIRE(decoder.take_frame_ready());
+        REQUIRE(decoder.decode(make_sacn_sync(7000)) == Packet::sync);
+        REQUIRE(decoder.take_frame_ready());
+
+        // unsynchronized data is latched straight away
+        REQUIRE(decoder.decode(make_sacn(1, {0xFF, 0xFF, 0xFF})) == Packet::dmx);
+        REQUIRE(decoder.take_frame_ready());
+    }
+
+    SECTION("UDP loopback")
+    {
+        // bound to this run's decoder, too big for the stack
+        auto receiver_ptr = std::make_unique<tlc5955::DmxUdpReceiver>(decoder);
+        auto &receiver    = *receiver_ptr;
+        REQUIRE(receiver.open(0, INADDR_LOOPBACK));
+        REQUIRE(receiver.get_port() != 0);
+
+        int sender = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(receiver.get_port());
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for (uint16_t universe = 1; universe <= 2; universe++)
+        {
+            auto packet = make_artdmx(universe, std::vector<uint8_t>(512, 0xFF));
+            sendto(sender, packet.data(), packet.size(), 0, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        }
+        close(sender);
+
+        int num_received = 0;
+        for (int attempt = 0; attempt < 10 && num_received < 2; attempt++)
+        {
+            num_received += receiver.receive(100);
+        }
+        REQUIRE(num_received == 2);
+        REQUIRE(decoder.get_dmx_packet_count() == 2);
+        REQUIRE(frame.get_colour(31, tlc5955::ColourChannel::blue) == 0xFFFF);
+        receiver.close();
+    }
+}
+
+TEST_CASE("Testing TLC5955 parallel chain renderer", "[tlc5955]")
+{
+    constexpr size_t num_chains = 37;
+    constexpr size_t chips_per_chain = 4;
+    static std::array<tlc5955::GreyscaleFrame<chips_per_chain>, num_chains> frames;
+    static std::array<std::array<uint8_t, tlc5955::chain_bitstream_size_bytes(chips_per_chain)>, num_chains> sent;
+    static std::array<std::atomic<uint32_t>, num_chains> render_count;
+    uint16_t pwm = 0;
+
+    tlc5955::ChainSetRenderer renderer(num_chains, tlc5955::chain_bitstream_size_bytes(chips_per_chain),
+        [&](size_t chain_idx, std::span<uint8_t> scratch)
+        {
+            frames[chain_idx].fill_rgb(static_cast<uint16_t>(pwm + chain_idx), 0, 0);
+            tlc5955::pack_chain_bitstream(frames[chain_idx].data(), false, scratch);
+            std::copy(scratch.begin(), scratch.end(), sent[chain_idx].begin());
+            render_count[chain_idx].fetch_add(1);
+        },
+        4);
+    REQUIRE(renderer.get_num_workers() == 4);
+
+    for (uint16_t frame_idx = 0; frame_idx < 50; frame_idx++)
+    {
+        pwm = static_cast<uint16_t>(frame_idx * 100);
+        REQUIRE(renderer.render_frame());
+        // every chain is rendered exactly once per frame, with this frame's data
+        for (size_t chain_idx = 0; chain_idx < num_chains; chain_idx++)
+        {
+            REQUIRE(render_count[chain_idx].load() == frame_idx + 1u);
+            REQUIRE(frames[chain_idx].get_colour(0, tlc5955::ColourChannel::red) == pwm + chain_idx);
+        }
+    }
+
+    static std::array<uint8_t, tlc5955::chain_bitstream_size_bytes(chips_per_chain)> expected;
+    tlc5955::pack_chain_bitstream(frames[5].data(), false, expected);
+    REQUIRE(sent[5] == expected);
+
+    // too many chains for the 24-bit shares: nothing is rendered
+    bool rendered = false;
+    tlc5955::ChainSetRenderer too_many(tlc5955::ChainSetRenderer::max_chains + 1, 0, [&](size_t, std::span<uint8_t>) { rendered = true; }, 1);
+    REQUIRE_FALSE(too_many.render_frame());
+    REQUIRE_FALSE(rendered);
+}
+
+TEST_CASE("Stress testing TLC5955 parallel chain renderer", "[tlc5955]")
+{
+    // more workers than chains, frames back-to-back: idle workers are still leaving the last frame
+    // while the next one starts
+    constexpr size_t num_chains = 3;
+    static std::array<std::atomic<uint32_t>, num_chains> render_count;
+    static std::array<uint32_t, num_chains> input;
+    bool all_counted = true;
+    bool inputs_seen = true;
+    uint32_t frame_input = 0;
+
+    tlc5955::ChainSetRenderer renderer(num_chains, 16,
+        [&](size_t chain_idx, std::span<uint8_t>)
+        {
+            // written by the caller before render_frame()
+            input[chain_idx] = frame_input;
+            render_count[chain_idx].fetch_add(1);
+        },
+        8);
+
+    constexpr uint32_t num_frames = 20000;
+    for (uint32_t frame_idx = 0; frame_idx < num_frames; frame_idx++)
+    {
+        frame_input = frame_idx;
+        renderer.render_frame();
+        for (size_t chain_idx = 0; chain_idx < num_chains; chain_idx++)
+        {
+            all_counted = all_counted && render_count[chain_idx].load() == frame_idx + 1;
+            inputs_seen = inputs_seen && input[chain_idx] == frame_idx;
+        }
+    }
+    REQUIRE(all_counted);
+    REQUIRE(inputs_seen);
+}
+
+TEST_CASE("Testing TLC5955 crossfade", "[tlc5955]")
+{
+    static tlc5955::GreyscaleFrame<2> from;
+    static tlc5955::GreyscaleFrame<2> to;
+    static tlc5955::GreyscaleFrame<2> out;
+    uint32_t seed = 1;
+    for (size_t chip_idx = 0; chip_idx < 2; chip_idx++)
+    {
+        for (size_t channel_idx = 0; channel_idx < tlc5955::gs_channels_per_chip; channel_idx++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            from.set_channel(chip_idx, channel_idx, static_cast<uint16_t>(seed >> 16));
+            seed = seed * 1664525 + 1013904223;
+            to.set_channel(chip_idx, channel_idx, static_cast<uint16_t>(seed >> 16));
+        }
+    }
+    from.set_channel(0, 0, 0xFFFF);
+    to.set_channel(0, 0, 0x0000);
+
+    SECTION("endpoints")
+    {
+        tlc5955::crossfade(from, to, 0, out);
+        REQUIRE(std::equal(out.data().begin(), out.data().end(), from.data().begin()));
+        tlc5955::crossfade(from, to, tlc5955::crossfade_weight_max, out);
+        REQUIRE(std::equal(out.data().begin(), out.data().end(), to.data().begin()));
+        tlc5955::crossfade(from, to, 1000, out);
+        REQUIRE(std::equal(out.data().begin(), out.data().end(), to.data().begin()));
+        REQUIRE(tlc5955::crossfade_weight(0, 10) == 0);
+        REQUIRE(tlc5955::crossfade_weight(5, 10) == 128);
+        REQUIRE(tlc5955::crossfade_weight(10, 10) == tlc5955::crossfade_weight_max);
+    }
+
+    SECTION("word and channel kernels match")
+    {
+        static std::array<uint8_t, tlc5955::GreyscaleFrame<2>::m_size_bytes> by_channel;
+        for (uint16_t weight = 0; weight <= tlc5955::crossfade_weight_max; weight++)
+        {
+            tlc5955::detail::crossfade_channels(from.data().data(), to.data().data(), weight, by_channel.data(), 96);
+            tlc5955::detail::crossfade_words(from.data().data(), to.data().data(), weight, out.data().data(), 48);
+            REQUIRE(std::equal(out.data().begin(), out.data().end(), by_channel.begin()));
+        }
+        tlc5955::crossfade(from, to, 64, out);
+        REQUIRE(out.get_channel(0, 0) == (0xFFFF * 192) / 256);
+        REQUIRE(out.get_channel(1, 47) == (from.get_channel(1, 47) * 192 + to.get_channel(1, 47) * 64) / 256);
+    }
+
+    SECTION("unaligned and mismatched buffers")
+    {
+        static std::array<uint8_t, 8> unaligned;
+        REQUIRE(tlc5955::crossfade(from.data().subspan(0, 6), to.data().subspan(0, 6), 128,
+                                   std::span<uint8_t>(unaligned).subspan(1, 6)));
+        REQUIRE(((unaligned[1] << 8) | unaligned[2]) == 0xFFFF / 2);
+        REQUIRE_FALSE(tlc5955::crossfade(from.data(), to.data().subspan(0, 96), 128, out.data()));
+        REQUIRE_FALSE(tlc5955::crossfade(from.data().subspan(0, 3), to.data().subspan(0, 3), 128, out.data().subspan(0, 3)));
+    }
+
+    SECTION("in place")
+    {
+        static tlc5955::GreyscaleFrame<2> expected;
+        tlc5955::crossfade(from, to, 200, expected);
+        out = from;
+        tlc5955::crossfade(out, to, 200, out);
+        REQUIRE(std::equal(out.data().begin(), out.data().end(), expected.data().begin()));
+    }
+}
+
+TEST_CASE("Testing TLC5955 layer compositor", "[tlc5955]")
+{
+    // 2 chips as an 8x4 grid: background, overlay, status indicator
+    static tlc5955::Compositor<2, 3, 8> compositor;
+    static tlc5955::GreyscaleFrame<2> frame;
+    compositor = tlc5955::Compositor<2, 3, 8>{};
+    REQUIRE(compositor.m_height == 4);
+
+    REQUIRE(compositor.fill_rect(0, tlc5955::Rect{0, 0, 8, 4}, 0x1000, 0x2000, 0x3000));
+    REQUIRE(compositor.composite(frame));
+    REQUIRE(frame.get_colour(31, tlc5955::ColourChannel::blue) == 0x3000);
+    REQUIRE_FALSE(compositor.composite(frame));
+
+    SECTION("dirty rectangle")
+    {
+        // only the indicator pixel is recomputed
+        REQUIRE(compositor.set_pixel(2, 7, 0, 0xFFFF, 0, 0));
+        REQUIRE(compositor.get_dirty_rect().width == 1);
+        frame.set_rgb(0, 0, 0, 0);
+        REQUIRE(compositor.composite(frame));
+        REQUIRE(frame.get_colour(7, tlc5955::ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0);
+
+        // the union of two draws, clipped to the grid
+        REQUIRE(compositor.fill_rect(1, tlc5955::Rect{1, 1, 2, 1}, 0, 0, 0));
+        REQUIRE(compositor.fill_rect(1, tlc5955::Rect{6, 2, 10, 10}, 0, 0, 0));
+        REQUIRE_FALSE(compositor.fill_rect(1, tlc5955::Rect{8, 0, 1, 1}, 0, 0, 0));
+        const tlc5955::Rect dirty = compositor.get_dirty_rect();
+        REQUIRE((dirty.x == 1 && dirty.y == 1 && dirty.width == 7 && dirty.height == 3));
+
+        // changing the layer alpha dirties the layer's content
+        compositor.composite(frame);
+        REQUIRE(compositor.set_alpha(2, 128));
+        REQUIRE(compositor.get_dirty_rect().x == 7);
+        REQUIRE(compositor.get_dirty_rect().width == 1);
+    }
+
+    SECTION("alpha and blend modes")
+    {
+        REQUIRE(compositor.set_pixel(1, 0, 0, 0xFFFF, 0xFFFF, 0x0000));
+        REQUIRE(compositor.set_alpha(1, 255));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+
+        REQUIRE(compositor.set_alpha(1, 128));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == (0x1000 * 127 + 0xFFFF * 129) / 256);
+
+        REQUIRE(compositor.set_alpha(1, 255));
+        REQUIRE(compositor.set_blend_mode(1, tlc5955::BlendMode::add));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::blue) == 0x3000);
+
+        REQUIRE(compositor.set_blend_mode(1, tlc5955::BlendMode::multiply));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::green) == 0x2000);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::blue) == 0);
+
+        REQUIRE(compositor.set_blend_mode(1, tlc5955::BlendMode::screen));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::green) == 0xFFFF);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::blue) == 0x3000);
+
+        // hidden and cleared layers show the background
+        REQUIRE(compositor.set_visible(1, false));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0x1000);
+        REQUIRE(compositor.set_visible(1, true));
+        REQUIRE(compositor.clear_layer(1));
+        compositor.composite(frame);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0x1000);
+        REQUIRE_FALSE(compositor.set_alpha(3, 0));
+    }
+}
+
+TEST_CASE("Testing TLC5955 colour correction", "[tlc5955]")
+{
+    static constexpr std::array<tlc5955::ColourMatrix, 2> bins{{
+        tlc5955::identity_colour_matrix,
+        // bin 1: red LEDs leak into green, blue is weak
+        tlc5955::make_colour_matrix({0.9, 0.0, 0.0, -0.1, 1.0, 0.0, 0.0, 0.0, 3.0}),
+    }};
+    static constexpr std::array<uint8_t, 3> led_bins{0, 1, 7};
+    static tlc5955::GreyscaleFrame<1> frame;
+    static std::array<uint8_t, tlc5955::leds_per_chip * 3> rgb{};
+    rgb.fill(0);
+    rgb[0] = 0xFF;              // LED0 red
+    rgb[3] = 0xFF;              // LED1 red
+    rgb[4] = 0xFF;              // LED1 green
+    rgb[5] = 0xFF;              // LED1 blue
+    rgb[6] = 0x80;              // LED2 red
+
+    REQUIRE(bins[1].coefficients[0] == 3686);
+    REQUIRE(bins[1].coefficients[3] == -410);
+    REQUIRE(bins[1].coefficients[8] == 8192);
+
+    SECTION("gamma and brightness only")
+    {
+        tlc5955::ColourCorrector corrector(tlc5955::gamma_table_linear);
+        REQUIRE(corrector.pack(rgb, frame));
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::green) == 0);
+        corrector.set_brightness(128);
+        REQUIRE(corrector.pack(rgb, frame));
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0x7FFF);
+        REQUIRE(frame.get_colour(2, tlc5955::ColourChannel::red) == (0x8080 * 128) >> 8);
+        corrector.set_brightness(1000);
+        REQUIRE(corrector.get_brightness() == 256);
+    }
+
+    SECTION("per-LED bins")
+    {
+        tlc5955::ColourCorrector corrector(tlc5955::gamma_table_linear, bins, led_bins);
+        REQUIRE(corrector.pack(rgb, frame));
+        // bin 0
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+        // bin 1: scaled, negative contribution, clamped
+        REQUIRE(frame.get_colour(1, tlc5955::ColourChannel::red) == (0xFFFF * 3686 + 2048) / 4096);
+        REQUIRE(frame.get_colour(1, tlc5955::ColourChannel::green) == (0xFFFF * (4096 - 410) + 2048) / 4096);
+        REQUIRE(frame.get_colour(1, tlc5955::ColourChannel::blue) == 0xFFFF);
+        // out of range bin and LEDs past the index table use the identity
+        REQUIRE(frame.get_colour(2, tlc5955::ColourChannel::red) == 0x8080);
+
+        // a partial pack selects matrices by chain index
+        REQUIRE(corrector.pack(std::span<const uint8_t>(rgb).subspan(3, 3), frame.data().subspan(6, 6), 1));
+        REQUIRE(frame.get_colour(1, tlc5955::ColourChannel::red) == (0xFFFF * 3686 + 2048) / 4096);
+        REQUIRE_FALSE(corrector.pack(std::span<const uint8_t>(rgb).subspan(0, 4), frame.data().subspan(0, 8)));
+    }
+}
+
+TEST_CASE("Testing TLC5955 power limiter", "[tlc5955]")
+{
+    REQUIRE(tlc5955::output_full_scale_na(1, 127, 127) == 8000000);
+    REQUIRE(tlc5955::output_full_scale_na(7, 0, 127) == 3190000);
+    REQUIRE(tlc5955::output_full_scale_na(0, 127, 0) == 838400);
+
+    static tlc5955::GreyscaleFrame<2> frame;
+    frame.clear();
+    // 32 LEDs at full white, MC 8mA: 32 * 3 * 8mA = 768mA
+    tlc5955::PowerLimiter<2> limiter(frame, 1000000);
+    limiter.set_control({{127, 127, 127}}, {{1, 1, 1}}, 127);
+    REQUIRE(limiter.estimate_ua() == 0);
+    for (size_t led_idx = 0; led_idx < 32; led_idx++)
+    {
+        REQUIRE(limiter.set_rgb(led_idx, 0xFFFF, 0xFFFF, 0xFFFF));
+    }
+    REQUIRE(limiter.estimate_ua() == 768000);
+    REQUIRE_FALSE(limiter.update());
+    REQUIRE(limiter.get_greyscale_scale() == 256);
+
+    SECTION("incremental updates match a rescan")
+    {
+        REQUIRE(limiter.set_rgb(3, 0x8000, 0, 0x1234));
+        REQUIRE(limiter.set_channel(1, 47, 0));
+        REQUIRE_FALSE(limiter.set_rgb(32, 0, 0, 0));
+        const uint32_t incremental_ua = limiter.estimate_ua();
+        limiter.recalculate();
+        REQUIRE(limiter.estimate_ua() == incremental_ua);
+    }
+
+    SECTION("budget scales BC")
+    {
+        limiter.set_budget(400000);
+        REQUIRE(limiter.update());
+        const std::array<uint8_t, 3> brightness = limiter.get_global_brightness();
+        REQUIRE(brightness[0] < 127);
+        REQUIRE(brightness[0] == brightness[2]);
+        REQUIRE(limiter.limited_estimate_ua() <= 400000);
+        REQUIRE(limiter.limited_estimate_ua() > 390000);
+        REQUIRE(limiter.get_greyscale_scale() == 256);
+        REQUIRE_FALSE(limiter.update());
+    }
+
+    SECTION("budget below minimum BC scales GS")
+    {
+        limiter.set_budget(10000);
+        REQUIRE(limiter.update());
+        REQUIRE(limiter.get_global_brightness()[1] == 0);
+        REQUIRE(limiter.get_greyscale_scale() < 256);
+        REQUIRE(limiter.limited_estimate_ua() <= 10000);
+    }
+}
+
+TEST_CASE("Testing TLC5955 blank frame gating", "[tlc5955]")
+{
+    TIM4 = new TIM_TypeDef;
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+
+    tlc5955::Driver d(tlc5955_spi_interface);
+    static tlc5955::GreyscaleFrame<2> frame;
+    frame.clear();
+    TIM4->CR1 = TIM_CR1_CEN;
+    using Driver = tlc5955::Driver;
+
+    REQUIRE(Driver::is_blank_frame(frame.data()));
+
+    SECTION("always send")
+    {
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send));
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send));
+        REQUIRE(d.get_stats().frames_sent == 4);
+        REQUIRE_FALSE(d.is_blanked());
+    }
+
+    SECTION("skip repeated blank frames and stop GSCLK")
+    {
+        d.set_blank_frame_option(Driver::BlankFrameOption::skip_repeated_stop_gsclk);
+
+        // the first blank frame is sent to turn the outputs off
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send));
+        REQUIRE(d.is_blanked());
+        REQUIRE((TIM4->CR1 & TIM_CR1_CEN) == 0);
+        REQUIRE(d.get_stats().frames_sent == 2);
+
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send));
+        REQUIRE(d.get_stats().frames_sent == 2);
+        REQUIRE(d.get_stats().blank_frames_skipped == 1);
+
+        // content returns
+        frame.set_rgb(31, 0, 0, 1);
+        REQUIRE_FALSE(Driver::is_blank_frame(frame.data()));
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::latch_after_send));
+        REQUIRE_FALSE(d.is_blanked());
+        REQUIRE((TIM4->CR1 & TIM_CR1_CEN) == TIM_CR1_CEN);
+        REQUIRE(d.get_stats().frames_sent == 4);
+
+        // an unlatched blank frame does not blank the outputs
+        frame.clear();
+        REQUIRE(d.send_frame(frame.data(), Driver::DataLatchType::data, Driver::LatchPinOption::no_latch));
+        REQUIRE_FALSE(d.is_blanked());
+        REQUIRE(d.get_stats().frames_sent == 6);
+    }
+}
+
+TEST_CASE("Testing TLC5955 static pool", "[tlc5955]")
+{
+    static tlc5955::FramePool<2, 3> frames;
+    REQUIRE(frames.capacity() == 3);
+    REQUIRE(frames.available() == 3);
+
+    std::array<tlc5955::GreyscaleFrame<2> *, 3> allocated{};
+    for (auto &frame : allocated)
+    {
+        frame = frames.allocate();
+        REQUIRE(frame != nullptr);
+        REQUIRE(reinterpret_cast<uintptr_t>(frame->data().data()) % 4 == 0);
+    }
+    REQUIRE(frames.allocate() == nullptr);
+    REQUIRE(frames.size() == 3);
+
+    allocated[1]->set_rgb(0, 1, 2, 3);
+    size_t idx = 0;
+    REQUIRE(frames.index_of(allocated[1], idx));
+    REQUIRE(frames.at(idx)->get_colour(0, tlc5955::ColourChannel::blue) == 3);
+
+    // the released block is reused first, freshly constructed
+    REQUIRE(frames.release(allocated[1]));
+    REQUIRE_FALSE(frames.release(allocated[1]));
+    REQUIRE(frames.at(idx) == nullptr);
+    tlc5955::GreyscaleFrame<2> *reused = frames.allocate();
+    REQUIRE(reused == allocated[1]);
+    REQUIRE(reused->get_colour(0, tlc5955::ColourChannel::blue) == 0);
+
+    // pointers from elsewhere are rejected
+    static tlc5955::GreyscaleFrame<2> not_pooled;
+    REQUIRE_FALSE(frames.release(&not_pooled));
+
+    for (auto &frame : allocated)
+    {
+        REQUIRE(frames.release(frame));
+    }
+    REQUIRE(frames.available() == 3);
+
+    // non-copyable types are constructed in place
+    struct Node : public RestrictedBase
+    {
+        explicit Node(int value) : m_value(value) {}
+        int m_value;
+    };
+    static tlc5955::StaticPool<Node, 2> nodes;
+    Node *node = nodes.allocate(42);
+    REQUIRE(node->m_value == 42);
+    REQUIRE(nodes.release(node));
+}
+
+TEST_CASE("Testing TLC5955 keyframe animation", "[tlc5955]")
+{
+    using tlc5955::Easing;
+    using tlc5955::Keyframe;
+    REQUIRE(tlc5955::ease(Easing::ease_in, 32768) == 16384);
+    REQUIRE(tlc5955::ease(Easing::ease_out, 32768) == 49152);
+    REQUIRE(tlc5955::ease(Easing::ease_in_out, 32768) == 32768);
+    REQUIRE(tlc5955::ease(Easing::ease_in_out, 65536) == 65536);
+    REQUIRE(tlc5955::ease(Easing::step, 65535) == 0);
+
+    static tlc5955::GreyscaleFrame<1> frame;
+    frame.clear();
+    // 100 ticks per second
+    tlc5955::AnimationEngine<1, 4> engine(frame, 100);
+
+    static constexpr std::array<Keyframe, 3> fade{{
+        {0, 0, 0, 0, Easing::linear},
+        {1000, 0xFFFF, 0, 0, Easing::step},
+        {1500, 0, 0xFFFF, 0, Easing::linear},
+    }};
+    static constexpr std::array<Keyframe, 2> eased{{
+        {100, 0, 0, 0, Easing::ease_in_out},
+        {300, 0, 0, 0xF000, Easing::linear},
+    }};
+    REQUIRE(engine.add_track(0, 4, fade));
+    REQUIRE(engine.add_track(4, 1, eased, true));
+    REQUIRE_FALSE(engine.add_track(15, 2, fade));
+    REQUIRE_FALSE(engine.add_track(0, 1, std::span<const Keyframe>{}));
+
+    for (uint32_t tick = 0; tick < 100; tick++)
+    {
+        engine.tick();
+        // linear: within one step of the exact value
+        const uint32_t exact = (tick * 0xFFFF) / 100;
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) <= exact);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) + 1u >= exact);
+        REQUIRE(frame.get_colour(3, tlc5955::ColourChannel::red) == frame.get_colour(0, tlc5955::ColourChannel::red));
+        if (tick < 10)
+        {
+            // before the track's first keyframe
+            REQUIRE(frame.get_colour(4, tlc5955::ColourChannel::blue) == 0);
+        }
+        if (tick == 20)
+        {
+            // eased midpoint
+            REQUIRE(frame.get_colour(4, tlc5955::ColourChannel::blue) == 0x7800);
+        }
+    }
+
+    // the step holds until its segment ends, then the last keyframe holds
+    for (uint32_t tick = 100; tick < 150; tick++)
+    {
+        engine.tick();
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0xFFFF);
+    }
+    REQUIRE_FALSE(engine.is_finished());
+    engine.tick();
+    REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::green) == 0xFFFF);
+    REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == 0);
+
+    SECTION("loop and render ahead")
+    {
+        // the looping track restarts at its first keyframe every 200 ticks
+        static std::array<tlc5955::GreyscaleFrame<1>, 400> show;
+        engine.restart();
+        engine.render(show);
+        REQUIRE(show[20].get_colour(4, tlc5955::ColourChannel::blue) == 0x7800);
+        REQUIRE(show[229].get_colour(4, tlc5955::ColourChannel::blue) == show[29].get_colour(4, tlc5955::ColourChannel::blue));
+        REQUIRE(show[399].get_colour(0, tlc5955::ColourChannel::green) == 0xFFFF);
+        engine.clear_tracks();
+        REQUIRE(engine.is_finished());
+    }
+}
+
+TEST_CASE("Testing TLC5955 patterns", "[tlc5955]")
+{
+    using tlc5955::ColourChannel;
+    REQUIRE(tlc5955::sine_table[0] == 32768);
+    REQUIRE(tlc5955::sine_table[64] == 65535);
+    REQUIRE(tlc5955::sine_table[192] == 0);
+    REQUIRE(tlc5955::hue_table[0].red == 65535);
+    REQUIRE(tlc5955::hue_table[0].green == 0);
+    REQUIRE(tlc5955::hue_table[128].blue > 0);
+    REQUIRE(tlc5955::phase_step(1000, 100) == 42949672);
+
+    static tlc5955::GreyscaleFrame<1> frame;
+    const tlc5955::RgbColour white{0xFFFF, 0xFFFF, 0xFFFF};
+
+    SECTION("chase")
+    {
+        tlc5955::ChasePattern chase(white, 4, 1, 1);
+        chase.render(frame);
+        REQUIRE(frame.get_colour(0, ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(1, ColourChannel::red) == 0);
+        REQUIRE(frame.get_colour(4, ColourChannel::red) == 0xFFFF);
+        chase.render(frame);
+        REQUIRE(frame.get_colour(0, ColourChannel::red) == 0);
+        REQUIRE(frame.get_colour(1, ColourChannel::red) == 0xFFFF);
+    }
+
+    SECTION("rainbow")
+    {
+        tlc5955::RainbowPattern rainbow(1u << 24, 1u << 28);
+        rainbow.render(frame);
+        REQUIRE(frame.get_colour(0, ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(1, ColourChannel::red) == tlc5955::hue_table[16].red);
+        rainbow.render(frame);
+        REQUIRE(frame.get_colour(0, ColourChannel::green) == tlc5955::hue_table[1].green);
+    }
+
+    SECTION("breathe")
+    {
+        tlc5955::BreathePattern breathe(white, tlc5955::phase_step(1000, 4));
+        breathe.render(frame);
+        REQUIRE(frame.get_colour(15, ColourChannel::blue) == 0);
+        breathe.render(frame);
+        breathe.render(frame);
+        REQUIRE(frame.get_colour(15, ColourChannel::blue) == 0xFFFF);
+    }
+
+    SECTION("twinkle")
+    {
+        tlc5955::TwinklePattern<1> twinkle(white, 0x4000, 2);
+        twinkle.render(frame);
+        size_t lit = 0;
+        for (size_t led_idx = 0; led_idx < tlc5955::leds_per_chip; led_idx++)
+        {
+            lit += (frame.get_colour(led_idx, ColourChannel::red) == 0xFFFF) ? 1 : 0;
+        }
+        REQUIRE(lit > 0);
+        REQUIRE(lit < tlc5955::leds_per_chip);
+    }
+
+    SECTION("twinkle decay shift is clamped")
+    {
+        // 16 or more would never decay
+        tlc5955::TwinklePattern<1> twinkle(white, 0x4000, 16);
+        size_t decaying = 0;
+        for (int frame_idx = 0; frame_idx < 4; frame_idx++)
+        {
+            twinkle.render(frame);
+        }
+        for (size_t led_idx = 0; led_idx < tlc5955::leds_per_chip; led_idx++)
+        {
+            const uint16_t red = frame.get_colour(led_idx, ColourChannel::red);
+            decaying += (red != 0 && red != 0xFFFF) ? 1 : 0;
+        }
+        REQUIRE(decaying > 0);
+    }
+
+    SECTION("comet")
+    {
+        tlc5955::CometPattern comet(white, 4, 2u << 16);
+        comet.render(frame);
+        REQUIRE(frame.get_colour(0, ColourChannel::red) == 0xFFFF);
+        REQUIRE(frame.get_colour(15, ColourChannel::red) == 0xFFFF - 0x3FFF);
+        REQUIRE(frame.get_colour(12, ColourChannel::red) == 0);
+        comet.render(frame);
+        REQUIRE(frame.get_colour(2, ColourChannel::red) == 0xFFFF);
+    }
+}
+
+// hidden: run with the [.benchmark] tag
+TEST_CASE("Benchmark TLC5955 patterns", "[.benchmark]")
+{
+    static tlc5955::GreyscaleFrame<64> frame;
+    const tlc5955::RgbColour white{0xFFFF, 0xFFFF, 0xFFFF};
+    constexpr size_t num_frames = 2000;
+
+    auto report = [&](const char *name, auto render) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t frame_idx = 0; frame_idx < num_frames; frame_idx++)
+        {
+            render();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::setw(8) << name << ": "
+                  << static_cast<double>(num_frames * frame.m_num_leds) / seconds / 1e6 << " Mpixels/s" << std::endl;
+        REQUIRE(seconds > 0.0);
+    };
+
+    tlc5955::ChasePattern chase(white, 8, 2, 1);
+    tlc5955::RainbowPattern rainbow(1u << 24, 1u << 22);
+    tlc5955::BreathePattern breathe(white, tlc5955::phase_step(2000, 100));
+    static tlc5955::TwinklePattern<64> twinkle(white, 0x200, 3);
+    tlc5955::CometPattern comet(white, 32, 1u << 16);
+    report("chase", [&] { chase.render(frame); });
+    report("rainbow", [&] { rainbow.render(frame); });
+    report("breathe", [&] { breathe.render(frame); });
+    report("twinkle", [&] { twinkle.render(frame); });
+    report("comet", [&] { comet.render(frame); });
+}
+
+// hidden: run with the [.benchmark] tag
+TEST_CASE("Benchmark TLC5955 DMX decoder", "[.benchmark]")
+{
+    // hundreds of universes of 170 LEDs, synced by one sACN sync address
+    constexpr size_t num_universes = 400;
+    constexpr size_t num_frames = 200;
+    constexpr uint16_t sync_address = 63999;
+    static tlc5955::GreyscaleFrame<num_universes * 170 / tlc5955::leds_per_chip + 1> frame;
+    static std::array<tlc5955::DmxUniverseMap, num_universes> universe_map;
+    std::vector<std::vector<uint8_t>> packets;
+    for (size_t universe_idx = 0; universe_idx < num_universes; universe_idx++)
+    {
+        const uint16_t universe = static_cast<uint16_t>(universe_idx + 1);
+        universe_map[universe_idx] = {universe, 0, static_cast<uint32_t>(universe_idx * 170), 170,
+                                      tlc5955::DmxSlotFormat::rgb8, tlc5955::DmxColourOrder::rgb};
+        packets.push_back(make_sacn(universe, std::vector<uint8_t>(510, static_cast<uint8_t>(universe_idx)), sync_address));
+    }
+    const std::vector<uint8_t> sync = make_sacn_sync(sync_address);
+    static tlc5955::DmxDecoder decoder(frame.data(), universe_map);
+
+    size_t num_ready = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t frame_idx = 0; frame_idx < num_frames; frame_idx++)
+    {
+        for (const auto &packet : packets)
+        {
+            decoder.decode(packet);
+        }
+        decoder.decode(sync);
+        num_ready += decoder.take_frame_ready() ? 1 : 0;
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << std::setw(8) << "sACN" << ": " << static_cast<double>(num_frames) / seconds << " frames/s of " << num_universes
+              << " universes (44 needed), " << static_cast<double>(num_frames * num_universes) / seconds / 1e6 << " Mpackets/s"
+              << std::endl;
+    REQUIRE(num_ready == num_frames);
+    REQUIRE(seconds > 0.0);
+}
+
+TEST_CASE("Testing TLC5955 fault readback", "[tlc5955]")
+{
+    static std::array<uint8_t, 2 * tlc5955::chip_frame_size_bytes> sout{};
+    sout.fill(0);
+    // chip 0: channel 0 open, channel 47 shorted
+    sout[90] = 0x80;
+    sout[89] = 0x01;
+    // chip 1: channel 9 open, thermal shutdown
+    sout[96 + 91] = 0x40;
+    sout[96 + 83] = 0x01;
+
+    static tlc5955::FaultBitmap<2> faults;
+    REQUIRE_FALSE(faults.has_faults());
+    REQUIRE(faults.decode(sout));
+    REQUIRE(faults.is_open(0, 0));
+    REQUIRE_FALSE(faults.is_open(0, 1));
+    REQUIRE(faults.is_shorted(0, 47));
+    REQUIRE(faults.is_open(1, 9));
+    REQUIRE_FALSE(faults.is_overheated(0));
+    REQUIRE(faults.is_overheated(1));
+    REQUIRE(faults.count_open() == 2);
+    REQUIRE(faults.count_shorted() == 1);
+    REQUIRE(faults.has_faults());
+    REQUIRE(faults.open_bitmap().size() == 12);
+    REQUIRE_FALSE(faults.is_open(2, 0));
+    REQUIRE_FALSE(faults.decode(std::span<const uint8_t>(sout).subspan(0, 96)));
+
+    // the driver checks the capture buffer size
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+    tlc5955_spi_interface.set_miso(std::make_pair(GPIOB, GPIO_BSRR_BS6), 4);
+    REQUIRE(tlc5955_spi_interface.get_miso_port() == GPIOB);
+    tlc5955::Driver d(tlc5955_spi_interface);
+    static tlc5955::GreyscaleFrame<2> frame;
+    REQUIRE(d.send_frame(frame.data(), tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::latch_after_send, sout));
+    REQUIRE_FALSE(d.send_frame(frame.data(), tlc5955::Driver::DataLatchType::data, tlc5955::Driver::LatchPinOption::latch_after_send,
+                               std::span<uint8_t>(sout).subspan(0, 96)));
+}
+
+TEST_CASE("Testing TLC5955 per-chip chain control", "[tlc5955]")
+{
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+    CommonRegisterDriver d(tlc5955_spi_interface);
+    // a fresh chain for each section
+    tlc5955::ChainControl<3> chain;
+
+    SECTION("same layout as the common register")
+    {
+        tlc5955::Driver::ControlData control{};
+        control.pwm               = tlc5955::Driver::PwmFunction::enhanced_pwm;
+        control.global_brightness = {{0x7F, 0x40, 0x01}};
+        control.max_current       = {{0x7, 0x2, 0x5}};
+        control.dot_correction    = 0x55;
+        std::array<uint8_t, tlc5955::chip_frame_size_bytes> control_bytes{};
+        tlc5955::Driver::pack_control(control, control_bytes);
+
+        chain.set_all(tlc5955::ChipControl::from(control));
+        chain.pack();
+        REQUIRE(chain.data()[0] == 0x96);
+        for (size_t chip_idx = 0; chip_idx < 3; chip_idx++)
+        {
+            REQUIRE(std::equal(control_bytes.begin(), control_bytes.end(), chain.data().begin() + chip_idx * tlc5955::chip_frame_size_bytes));
+        }
+    }
+
+    SECTION("different DC and BC per chip in one stream")
+    {
+        REQUIRE(chain.set_global_brightness(1, 0x7F, 0x7F, 0x7F));
+        REQUIRE(chain.set_dot_correction(2, 47, 0x7F));
+        REQUIRE_FALSE(chain.set_dot_correction(3, 0, 0x7F));
+        REQUIRE_FALSE(chain.set_dot_correction(0, 48, 0x7F));
+        REQUIRE(chain.get_chip(1).global_brightness[0] == 0x7F);
+        REQUIRE(chain.get_chip(0).global_brightness[0] == 0x1);
+        chain.pack();
+        // the last DC is the last 7 bits of the chip
+        REQUIRE((chain.data()[3 * 96 - 1] & 0x7F) == 0x7F);
+        REQUIRE((chain.data()[2 * 96 - 1] & 0x7F) == 0x1F);
+
+        REQUIRE(chain.is_changed());
+        REQUIRE(chain.update(d));
+        // one stream for the chain, written twice
+        REQUIRE(d.get_stats().control_frames == 6);
+        REQUIRE(d.get_stats().latch_pulses == 2);
+        REQUIRE_FALSE(chain.is_changed());
+        REQUIRE_FALSE(chain.update(d));
+        REQUIRE(d.get_stats().control_frames == 6);
+        REQUIRE(d.get_stats().control_writes_skipped == 1);
+
+        REQUIRE(chain.set_dot_correction(0, 0, 0x20));
+        REQUIRE(chain.update(d));
+        REQUIRE(d.get_stats().control_frames == 12);
+
+        // e.g. after Driver::init()
+        chain.invalidate();
+        REQUIRE(chain.is_changed());
+        REQUIRE(chain.update(d));
+        REQUIRE(d.get_stats().control_frames == 18);
+    }
+}
+
+TEST_CASE("Testing TLC5955 shared frame regions", "[tlc5955]")
+{
+    // fresh regions for each section, too big for the stack
+    auto shared_ptr = std::make_unique<tlc5955::SharedFrame<4, 3>>();
+    auto &shared    = *shared_ptr;
+    static tlc5955::GreyscaleFrame<4> frame;
+    frame.clear();
+    // video, ticker and status
+    REQUIRE(shared.add_region(0, 40) == 0);
+    REQUIRE(shared.add_region(40, 20) == 1);
+    REQUIRE(shared.add_region(39, 2) == -1);
+    REQUIRE(shared.add_region(60, 5) == -1);
+    REQUIRE(shared.add_region(60, 4) == 2);
+    REQUIRE(shared.add_region(0, 1) == -1);
+    REQUIRE_FALSE(shared.set_rgb(1, 20, 1, 1, 1));
+
+    SECTION("unpublished writes are not sent")
+    {
+        REQUIRE(shared.fill_rgb(2, 0x1234, 0x5678, 0x9ABC));
+        REQUIRE(shared.snapshot(frame) == 0);
+        REQUIRE(frame.get_colour(60, tlc5955::ColourChannel::red) == 0);
+        REQUIRE(shared.publish(2));
+        REQUIRE(shared.snapshot(frame) == 1);
+        REQUIRE(frame.get_colour(63, tlc5955::ColourChannel::red) == 0x1234);
+        REQUIRE(frame.get_colour(63, tlc5955::ColourChannel::blue) == 0x9ABC);
+
+        // the back buffer keeps the published data for partial updates
+        REQUIRE(shared.set_rgb(2, 0, 1, 2, 3));
+        REQUIRE(shared.publish(2));
+        shared.snapshot(frame);
+        REQUIRE(frame.get_colour(60, tlc5955::ColourChannel::green) == 2);
+        REQUIRE(frame.get_colour(61, tlc5955::ColourChannel::green) == 0x5678);
+    }
+
+    SECTION("concurrent producers never tear a region")
+    {
+        constexpr uint16_t num_updates = 2000;
+        std::atomic<bool> start{false};
+        std::vector<std::thread> producers;
+        for (size_t region_idx = 0; region_idx < shared.get_num_regions(); region_idx++)
+        {
+            producers.emplace_back([&, region_idx] {
+                while (!start.load())
+                {
+                }
+                for (uint16_t update = 1; update <= num_updates; update++)
+                {
+                    shared.fill_rgb(region_idx, update, update, update);
+                    shared.publish(region_idx);
+                }
+            });
+        }
+        start.store(true);
+
+        const std::array<std::pair<size_t, size_t>, 3> regions{{{0, 40}, {40, 20}, {60, 4}}};
+        bool consistent = true;
+        bool finished   = false;
+        while (!finished)
+        {
+            finished = shared.get_epoch() == 3u * num_updates;
+            shared.snapshot(frame);
+            for (const auto &[first_led, num_leds] : regions)
+            {
+                const uint16_t first = frame.get_colour(first_led, tlc5955::ColourChannel::red);
+                for (size_t led_idx = first_led; led_idx < first_led + num_leds; led_idx++)
+                {
+                    consistent = consistent && frame.get_colour(led_idx, tlc5955::ColourChannel::blue) == first;
+                }
+            }
+        }
+        for (auto &producer : producers)
+        {
+            producer.join();
+        }
+        REQUIRE(consistent);
+        REQUIRE(frame.get_colour(0, tlc5955::ColourChannel::red) == num_updates);
+        REQUIRE(frame.get_colour(63, tlc5955::ColourChannel::green) == num_updates);
+    }
+}
+
+TEST_CASE("Testing TLC5955 command buffer", "[tlc5955]")
+{
+    static tlc5955::CommandBuffer<2, 64> commands;
+    static tlc5955::GreyscaleFrame<2> frame;
+    static tlc5955::GreyscaleFrame<2> expected;
+    commands.clear();
+    frame.clear();
+    expected.clear();
+
+    SECTION("coalesced GS edits")
+    {
+        REQUIRE(commands.set_rgb(20, 0x1111, 0x2222, 0x3333));
+        REQUIRE(commands.set_greyscale(0, 5, 0xAAAA));
+        REQUIRE(commands.set_rgb(20, 0x4444, 0x5555, 0x6666));
+        REQUIRE(commands.set_greyscale(0, 5, 0xBBBB));
+        REQUIRE_FALSE(commands.set_greyscale(2, 0, 1));
+        REQUIRE_FALSE(commands.set_rgb(32, 1, 1, 1));
+        REQUIRE(commands.size() == 8);
+        REQUIRE(commands.get_num_writes() == 4);
+        REQUIRE(commands.execute(frame));
+
+        expected.set_rgb(20, 0x4444, 0x5555, 0x6666);
+        expected.set_channel(0, 5, 0xBBBB);
+        REQUIRE(std::equal(frame.data().begin(), frame.data().end(), expected.data().begin()));
+
+        // replay onto another frame
+        static tlc5955::GreyscaleFrame<2> replayed;
+        replayed.fill_rgb(1, 1, 1);
+        REQUIRE(commands.execute(replayed));
+        REQUIRE(replayed.get_colour(20, tlc5955::ColourChannel::green) == 0x5555);
+        REQUIRE(replayed.get_colour(0, tlc5955::ColourChannel::green) == 1);
+        REQUIRE_FALSE(commands.execute(std::span<uint8_t>(frame.data()).subspan(0, 96)));
+    }
+
+    SECTION("control edits match ChainControl")
+    {
+        static tlc5955::ChainControl<2> chain;
+        tlc5955::ChipControl control{};
+        control.dot_correction[7] = 0x55;
+        control.global_brightness = {{0x7F, 0x01, 0x40}};
+        control.max_current[2]    = 0x6;
+        control.refresh           = tlc5955::Driver::RefreshFunction::auto_refresh_on;
+        chain.set_all(tlc5955::ChipControl{});
+        chain.set_chip(1, control);
+        chain.pack();
+
+        // start from the default control stream
+        static tlc5955::ChainControl<2> defaults;
+        defaults.pack();
+        static std::array<uint8_t, 192> stream;
+        std::copy(defaults.data().begin(), defaults.data().end(), stream.begin());
+
+        REQUIRE(commands.set_dot_correction(1, 7, 0x12));
+        REQUIRE(commands.set_dot_correction(1, 7, 0x55));
+        REQUIRE(commands.set_global_brightness(1, tlc5955::ColourChannel::blue, 0x7F));
+        REQUIRE(commands.set_global_brightness(1, tlc5955::ColourChannel::red, 0x40));
+        REQUIRE(commands.set_max_current(1, tlc5955::ColourChannel::red, 0x6));
+        REQUIRE(commands.set_function(1, tlc5955::Driver::DisplayFunction::display_repeat_off,
+                                      tlc5955::Driver::TimingFunction::timing_reset_on, tlc5955::Driver::RefreshFunction::auto_refresh_on,
+                                      tlc5955::Driver::PwmFunction::normal_pwm, tlc5955::Driver::ShortDetectFunction::threshold_90_percent));
+        REQUIRE(commands.get_num_writes() == 5);
+        REQUIRE(commands.execute(stream));
+        REQUIRE(std::equal(stream.begin(), stream.end(), chain.data().begin()));
+    }
+}
+
+TEST_CASE("Testing TLC5955 shared SPI bus scheduler", "[tlc5955]")
+{
+    // three chains on SPI2, each with a LAT pin (the mock GPIO only has a few pins)
+    tlc5955::Driver video(make_spi_interface(SPI2, GPIO_BSRR_BS9));
+    tlc5955::Driver ticker(make_spi_interface(SPI2, GPIO_BSRR_BS6));
+    tlc5955::Driver status(make_spi_interface(SPI2, GPIO_BSRR_BS6));
+    static SPI_TypeDef other_spi;
+    tlc5955::Driver other_bus(make_spi_interface(&other_spi, GPIO_BSRR_BS9));
+
+    tlc5955::BusScheduler<3> bus;
+    REQUIRE(bus.add_chain(status, 1) == 0);
+    REQUIRE(bus.add_chain(video, 10) == 1);
+    REQUIRE(bus.add_chain(other_bus, 5) == -1);
+    REQUIRE(bus.add_chain(ticker, 5) == 2);
+    REQUIRE(bus.add_chain(ticker, 5) == -1);
+    // same pins but full-duplex, so the shared bus setup would differ
+    tlc5955::DriverSerialInterface readback_interface = make_spi_interface(SPI2, GPIO_BSRR_BS9);
+    readback_interface.set_miso(std::make_pair(GPIOB, GPIO_BSRR_BS6), 4);
+    tlc5955::Driver readback(readback_interface);
+    tlc5955::BusScheduler<2> readback_bus;
+    REQUIRE(readback_bus.add_chain(video, 1) == 0);
+    REQUIRE(readback_bus.add_chain(readback, 1) == -1);
+
+    static tlc5955::GreyscaleFrame<2> frame_a;
+    static tlc5955::GreyscaleFrame<1> frame_b;
+    REQUIRE(bus.run_next() == -1);
+    REQUIRE_FALSE(bus.is_bus_configured());
+    REQUIRE_FALSE(bus.submit(3, frame_a.data()));
+    REQUIRE_FALSE(bus.submit(0, std::span<const uint8_t>(frame_a.data()).subspan(0, 100)));
+
+    REQUIRE(bus.submit(0, frame_a.data()));
+    REQUIRE(bus.submit(2, frame_b.data()));
+    REQUIRE(bus.submit(1, frame_a.data()));
+    // replaced before it was sent
+    REQUIRE(bus.submit(1, frame_b.data()));
+    REQUIRE(bus.get_stats().frames_superseded == 1);
+    REQUIRE(bus.is_pending(1));
+
+    REQUIRE(bus.run_next() == 1);
+    REQUIRE(bus.is_bus_configured());
+    REQUIRE_FALSE(bus.is_pending(1));
+    REQUIRE(video.get_stats().frames_sent == 1);
+    REQUIRE(video.get_stats().latch_pulses == 1);
+    REQUIRE(status.get_stats().latch_pulses == 0);
+    REQUIRE(bus.run_next() == 2);
+    REQUIRE(bus.run_next() == 0);
+    REQUIRE(status.get_stats().frames_sent == 2);
+    REQUIRE(bus.run() == 0);
+
+    // equal priority: oldest submission first
+    REQUIRE(bus.set_priority(0, 5));
+    REQUIRE(bus.submit(2, frame_b.data()));
+    REQUIRE(bus.submit(0, frame_b.data()));
+    REQUIRE(bus.run_next() == 2);
+    REQUIRE(bus.run() == 1);
+    REQUIRE(bus.get_stats().frames_sent == 5);
+    REQUIRE(bus.get_stats().frames_failed == 0);
+}
+
+TEST_CASE("Testing TLC5955 warm start snapshot", "[tlc5955]")
+{
+    static_assert(tlc5955::crc32(std::span<const uint8_t>()) == 0);
+    constexpr std::array<uint8_t, 9> check{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    static_assert(tlc5955::crc32(check) == 0xCBF43926);
+    REQUIRE(tlc5955::crc32(std::span(check).subspan(4), tlc5955::crc32(std::span(check).first(4))) == 0xCBF43926);
+
+    using snapshot_t = tlc5955::FrameSnapshot<2>;
+    static tlc5955::ChainControl<2> control;
+    static tlc5955::GreyscaleFrame<2> frame;
+    static std::array<uint8_t, snapshot_t::m_size_bytes> region;
+    region.fill(0xFF);
+    REQUIRE_FALSE(snapshot_t::is_valid(region));
+
+    control.set_global_brightness(1, 0x7F, 0x7F, 0x7F);
+    control.pack();
+    frame.set_rgb(31, 0xFFFF, 0x1234, 0);
+    REQUIRE(snapshot_t::save(region, control, frame));
+    REQUIRE_FALSE(snapshot_t::save(std::span<uint8_t>(region).first(100), control, frame));
+    REQUIRE(snapshot_t::is_valid(region));
+    REQUIRE(tlc5955::FrameSnapshot<3>::is_valid(region) == false);
+
+    static tlc5955::GreyscaleFrame<2> loaded;
+    REQUIRE(snapshot_t::load_greyscale(region, loaded));
+    REQUIRE(loaded.get_colour(31, tlc5955::ColourChannel::green) == 0x1234);
+    REQUIRE(std::equal(control.data().begin(), control.data().end(), snapshot_t::control_image(region).begin()));
+
+    tlc5955::DriverSerialInterface tlc5955_spi_interface = make_spi_interface();
+    tlc5955::Driver d(tlc5955_spi_interface);
+    REQUIRE(snapshot_t::restore(d, region));
+    REQUIRE(d.get_stats().control_frames == 4);
+    REQUIRE(d.get_stats().data_frames == 2);
+    REQUIRE(d.get_stats().latch_pulses == 3);
+
+    // a flipped bit is caught and nothing is sent
+    region[snapshot_t::m_greyscale_offset + 10] ^= 0x04;
+    REQUIRE_FALSE(snapshot_t::is_valid(region));
+    REQUIRE_FALSE(snapshot_t::restore(d, region));
+    REQUIRE(d.get_stats().latch_pulses == 3);
+}